@@ -0,0 +1,38 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Canvas PDF Writer
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Streams a paper canvas to a vector PDF file
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#import "CanvasView.h"
+
+@interface CanvasPDFWriter : NSObject
+{
+    CanvasView *canvasView;
+    NSString *path;
+    
+    CGContextRef pdfContext;
+    NSSize pageSize;
+    NSSize scale;
+    
+    NSInteger pageNum;
+    NSOperationQueue *queue;
+}
+
+- (id)initWithCanvasView:(CanvasView *)theCanvasView
+                    path:(NSString *)thePath;
+
+- (BOOL)open;
+- (void)update;
+- (void)close;
+
+- (NSString *)path;
+- (NSInteger)pageNum;
+
+@end
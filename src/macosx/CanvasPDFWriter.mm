@@ -0,0 +1,262 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Canvas PDF Writer
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Streams a paper canvas to a vector PDF file
+ */
+
+#import <vector>
+
+#import "CanvasPDFWriter.h"
+
+// Pages waiting for the writer thread. The remaining pages stay in the
+// canvas until the writer catches up, so memory use is constant.
+#define PDFWRITER_MAX_PENDING_PAGES 2
+
+// Channels at or above this level are considered blank paper
+#define PDFWRITER_PAPER_LEVEL       0xf0
+
+using namespace std;
+
+typedef struct
+{
+    NSInteger x;
+    NSInteger y;
+    NSInteger width;
+    NSInteger height;
+    unsigned int color;
+} CanvasPDFRect;
+
+typedef vector<CanvasPDFRect> CanvasPDFRects;
+
+static void fillRect(CGContextRef context, CanvasPDFRect& rect,
+                     NSInteger pageHeight, NSSize scale)
+{
+    CGContextSetRGBFillColor(context,
+                             ((rect.color >> 16) & 0xff) / 255.0F,
+                             ((rect.color >> 8) & 0xff) / 255.0F,
+                             (rect.color & 0xff) / 255.0F,
+                             1);
+    CGContextFillRect(context, CGRectMake(rect.x * scale.width,
+                                          (pageHeight - rect.y - rect.height) * scale.height,
+                                          rect.width * scale.width,
+                                          rect.height * scale.height));
+}
+
+// Converts the ink on a page bitmap into filled rectangles. Horizontal runs
+// of equal color are merged with identical runs on the previous row, so
+// printed dots and glyph strokes become a handful of rectangles each.
+// Row 0 of the bitmap is the top of the page.
+static void drawPage(CGContextRef context, NSBitmapImageRep *rep, NSSize scale)
+{
+    NSInteger width = [rep pixelsWide];
+    NSInteger height = [rep pixelsHigh];
+    NSInteger bytesPerPixel = [rep bitsPerPixel] / 8;
+    NSInteger bytesPerRow = [rep bytesPerRow];
+    unsigned char *data = [rep bitmapData];
+    
+    CanvasPDFRects openRects;
+    CanvasPDFRects nextRects;
+    
+    for (NSInteger y = 0; y <= height; y++)
+    {
+        nextRects.clear();
+        
+        CanvasPDFRects::iterator o = openRects.begin();
+        
+        NSInteger x = 0;
+        while (y < height && x < width)
+        {
+            unsigned char *p = data + y * bytesPerRow + x * bytesPerPixel;
+            
+            if ((p[0] >= PDFWRITER_PAPER_LEVEL) &&
+                (p[1] >= PDFWRITER_PAPER_LEVEL) &&
+                (p[2] >= PDFWRITER_PAPER_LEVEL))
+            {
+                x++;
+                
+                continue;
+            }
+            
+            unsigned int color = (p[0] << 16) | (p[1] << 8) | p[2];
+            
+            NSInteger runX = x;
+            for (x++; x < width; x++)
+            {
+                p += bytesPerPixel;
+                
+                if (((p[0] << 16) | (p[1] << 8) | p[2]) != color)
+                    break;
+            }
+            
+            CanvasPDFRect rect = {runX, y, x - runX, 1, color};
+            
+            // Flush open rectangles left of this run
+            while ((o != openRects.end()) && (o->x < rect.x))
+            {
+                fillRect(context, *o, height, scale);
+                
+                o++;
+            }
+            
+            if ((o != openRects.end()) &&
+                (o->x == rect.x) &&
+                (o->width == rect.width) &&
+                (o->color == rect.color))
+            {
+                rect = *o;
+                rect.height++;
+                
+                o++;
+            }
+            
+            nextRects.push_back(rect);
+        }
+        
+        for (; o != openRects.end(); o++)
+            fillRect(context, *o, height, scale);
+        
+        openRects.swap(nextRects);
+    }
+}
+
+@implementation CanvasPDFWriter
+
+- (id)initWithCanvasView:(CanvasView *)theCanvasView
+                    path:(NSString *)thePath
+{
+    self = [super init];
+    
+    if (self)
+    {
+        canvasView = theCanvasView;
+        path = [thePath copy];
+        
+        queue = [[NSOperationQueue alloc] init];
+        [queue setMaxConcurrentOperationCount:1];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [self close];
+    
+    [path release];
+    [queue release];
+    
+    [super dealloc];
+}
+
+- (BOOL)open
+{
+    if (pdfContext)
+        return YES;
+    
+    NSSize pixelDensity = [canvasView canvasPixelDensity];
+    pageSize = [canvasView pageSize];
+    
+    if (!pixelDensity.width || !pixelDensity.height ||
+        !pageSize.width || !pageSize.height)
+        return NO;
+    
+    scale = NSMakeSize(72.0F / pixelDensity.width,
+                       72.0F / pixelDensity.height);
+    
+    CGRect mediaBox = CGRectMake(0, 0,
+                                 pageSize.width * scale.width,
+                                 pageSize.height * scale.height);
+    
+    pdfContext = CGPDFContextCreateWithURL((CFURLRef)[NSURL fileURLWithPath:path],
+                                           &mediaBox,
+                                           NULL);
+    
+    pageNum = 0;
+    
+    return (pdfContext != NULL);
+}
+
+- (void)writePage:(NSBitmapImageRep *)rep
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    CGPDFContextBeginPage(pdfContext, NULL);
+    
+    drawPage(pdfContext, rep, scale);
+    
+    CGPDFContextEndPage(pdfContext);
+    
+    [pool drain];
+}
+
+- (void)queuePage:(NSInteger)index
+{
+    NSRect rect = NSMakeRect(0, index * pageSize.height,
+                             pageSize.width, pageSize.height);
+    
+    NSBitmapImageRep *rep = [canvasView canvasBitmap:rect];
+    if (!rep)
+        return;
+    
+    NSInvocationOperation *operation;
+    operation = [[NSInvocationOperation alloc] initWithTarget:self
+                                                     selector:@selector(writePage:)
+                                                       object:rep];
+    [queue addOperation:operation];
+    [operation release];
+}
+
+- (void)update
+{
+    if (!pdfContext)
+        return;
+    
+    NSInteger completePageNum = (NSInteger) ([canvasView canvasSize].height /
+                                             pageSize.height);
+    
+    while ((pageNum < completePageNum) &&
+           ([queue operationCount] < PDFWRITER_MAX_PENDING_PAGES))
+        [self queuePage:pageNum++];
+}
+
+- (void)close
+{
+    if (!pdfContext)
+        return;
+    
+    // Write complete pages, then the page being printed
+    NSInteger completePageNum = (NSInteger) ([canvasView canvasSize].height /
+                                             pageSize.height);
+    
+    while (pageNum < completePageNum)
+    {
+        [self queuePage:pageNum++];
+        
+        [queue waitUntilAllOperationsAreFinished];
+    }
+    
+    if ([canvasView canvasSize].height > pageNum * pageSize.height)
+        [self queuePage:pageNum++];
+    
+    [queue waitUntilAllOperationsAreFinished];
+    
+    CGPDFContextClose(pdfContext);
+    CGContextRelease(pdfContext);
+    pdfContext = NULL;
+}
+
+- (NSString *)path
+{
+    return path;
+}
+
+- (NSInteger)pageNum
+{
+    return pageNum;
+}
+
+@end
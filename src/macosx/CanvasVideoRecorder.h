@@ -0,0 +1,60 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Canvas Video Recorder
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Records canvas frames and audio to lossless AVI files
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define CANVASVIDEORECORDER_FRAMERATE   60
+#define CANVASVIDEORECORDER_SLOTNUM     16
+
+typedef struct
+{
+    double time;
+    unsigned char *pixels;
+} CanvasVideoFrame;
+
+@interface CanvasVideoRecorder : NSObject
+{
+    NSString *path;
+    void *paAudio;
+    NSString *audioPath;
+    
+    FILE *file;
+    void *parts;
+    
+    int width;
+    int height;
+    CanvasVideoFrame slots[CANVASVIDEORECORDER_SLOTNUM];
+    
+    volatile int32_t head;
+    volatile int32_t tail;
+    dispatch_semaphore_t frameSemaphore;
+    dispatch_semaphore_t finishSemaphore;
+    volatile BOOL stopRequested;
+    
+    double startTime;
+    long long frameNum;
+    long long droppedFrameNum;
+    long long fileSize;
+}
+
+- (id)initWithPath:(NSString *)thePath
+           paAudio:(void *)thePAAudio;
+
+- (BOOL)open;
+- (void)captureFrame;
+- (void)close;
+
+- (NSString *)path;
+- (NSInteger)backlog;
+- (long long)frameNum;
+- (long long)droppedFrameNum;
+- (long long)fileSize;
+
+@end
@@ -0,0 +1,734 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Canvas Video Recorder
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Records canvas frames and audio to a lossless AVI file
+ */
+
+#import <libkern/OSAtomic.h>
+#import <OpenGL/gl.h>
+
+#import <string>
+#import <vector>
+
+#import "CanvasVideoRecorder.h"
+
+#import "NSStringAdditions.h"
+
+#import "PAAudio.h"
+
+#define AVIF_HASINDEX       0x00000010
+#define AVIIF_KEYFRAME      0x00000010
+
+#define AVI_AUDIOCHUNK_SIZE 0x10000
+
+// AVI 1.0 offsets and sizes are 32-bit, and many readers stop at 1 GB,
+// so recordings are split into several files before reaching that size.
+// Audio is muxed on close, so its space is reserved at a generous rate.
+#define AVI_MAXFILESIZE     0x40000000
+#define AVI_AUDIORESERVE    (48000 * 8)
+
+using namespace std;
+
+typedef struct
+{
+    char chunkId[4];
+    OEInt flags;
+    OEInt offset;
+    OEInt size;
+} CanvasVideoIndexEntry;
+
+typedef vector<CanvasVideoIndexEntry> CanvasVideoIndex;
+
+typedef struct
+{
+    string path;
+    CanvasVideoIndex index;
+    long long moviOffset;
+    long long moviEnd;
+    long long startFrame;
+    long long frameNum;
+    long long maxChunkSize;
+} CanvasVideoPart;
+
+typedef vector<CanvasVideoPart> CanvasVideoParts;
+
+typedef struct
+{
+    OEInt formatTag;
+    OEInt channelNum;
+    OEInt sampleRate;
+    OEInt blockAlign;
+    OEInt bitsPerSample;
+    const unsigned char *data;
+    OEInt size;
+} CanvasVideoAudio;
+
+static void writeFourCC(FILE *fp, const char *value)
+{
+    fwrite(value, 1, 4, fp);
+}
+
+static void writeLE16(FILE *fp, OEInt value)
+{
+    unsigned char data[2] = {(unsigned char) value, (unsigned char) (value >> 8)};
+    
+    fwrite(data, 1, 2, fp);
+}
+
+static void writeLE32(FILE *fp, OEInt value)
+{
+    unsigned char data[4] = {
+        (unsigned char) value,
+        (unsigned char) (value >> 8),
+        (unsigned char) (value >> 16),
+        (unsigned char) (value >> 24),
+    };
+    
+    fwrite(data, 1, 4, fp);
+}
+
+static OEInt readLE16(const unsigned char *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static OEInt readLE32(const unsigned char *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+}
+
+// Finds the format and sample data of a RIFF WAVE file
+static bool parseWAV(NSData *wav, CanvasVideoAudio& audio)
+{
+    const unsigned char *data = (const unsigned char *)[wav bytes];
+    OEInt size = (OEInt) [wav length];
+    
+    if ((size < 12) ||
+        memcmp(data, "RIFF", 4) ||
+        memcmp(data + 8, "WAVE", 4))
+        return false;
+    
+    bool hasFormat = false;
+    audio.data = NULL;
+    
+    for (OEInt offset = 12; offset + 8 <= size;)
+    {
+        const unsigned char *chunk = data + offset;
+        OEInt chunkSize = readLE32(chunk + 4);
+        if (chunkSize > size - offset - 8)
+            chunkSize = size - offset - 8;
+        
+        if (!memcmp(chunk, "fmt ", 4) && (chunkSize >= 16))
+        {
+            audio.formatTag = readLE16(chunk + 8);
+            audio.channelNum = readLE16(chunk + 10);
+            audio.sampleRate = readLE32(chunk + 12);
+            audio.blockAlign = readLE16(chunk + 20);
+            audio.bitsPerSample = readLE16(chunk + 22);
+            
+            // WAVE_FORMAT_EXTENSIBLE: use the sub format
+            if ((audio.formatTag == 0xfffe) && (chunkSize >= 26))
+                audio.formatTag = readLE16(chunk + 32);
+            
+            hasFormat = true;
+        }
+        else if (!memcmp(chunk, "data", 4))
+        {
+            audio.data = chunk + 8;
+            audio.size = chunkSize;
+        }
+        
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    
+    return hasFormat && audio.data && audio.blockAlign;
+}
+
+@implementation CanvasVideoRecorder
+
+- (id)initWithPath:(NSString *)thePath
+           paAudio:(void *)thePAAudio
+{
+    self = [super init];
+    
+    if (self)
+    {
+        path = [thePath copy];
+        paAudio = thePAAudio;
+        
+        parts = new CanvasVideoParts();
+        
+        frameSemaphore = dispatch_semaphore_create(0);
+        finishSemaphore = dispatch_semaphore_create(0);
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [self close];
+    
+    [path release];
+    [audioPath release];
+    
+    delete (CanvasVideoParts *)parts;
+    
+    for (int i = 0; i < CANVASVIDEORECORDER_SLOTNUM; i++)
+        free(slots[i].pixels);
+    
+    dispatch_release(frameSemaphore);
+    dispatch_release(finishSemaphore);
+    
+    [super dealloc];
+}
+
+- (void)writeChunk:(const char *)chunkId
+              data:(const void *)data
+              size:(OEInt)size
+             flags:(OEInt)flags
+              part:(CanvasVideoPart&)part
+{
+    CanvasVideoIndexEntry entry;
+    memcpy(entry.chunkId, chunkId, 4);
+    entry.flags = flags;
+    entry.offset = (OEInt) (ftello(file) - part.moviOffset);
+    entry.size = size;
+    part.index.push_back(entry);
+    
+    if (!memcmp(chunkId, "00dc", 4))
+        part.frameNum++;
+    
+    writeFourCC(file, chunkId);
+    writeLE32(file, size);
+    if (size)
+        fwrite(data, 1, size, file);
+    if (size & 1)
+        fputc(0, file);
+    
+    if (size > part.maxChunkSize)
+        part.maxChunkSize = size;
+    
+    fileSize += 8 + size + (size & 1);
+}
+
+- (void)writeChunk:(const char *)chunkId
+              data:(const void *)data
+              size:(OEInt)size
+             flags:(OEInt)flags
+{
+    if (!file)
+        return;
+    
+    [self writeChunk:chunkId
+                data:data
+                size:size
+               flags:flags
+                part:((CanvasVideoParts *)parts)->back()];
+}
+
+- (void)writeHeaders:(CanvasVideoPart *)part
+               audio:(CanvasVideoAudio *)audio
+{
+    BOOL hasAudio = (audioPath != nil);
+    OEInt videoFrameNum = (OEInt) part->frameNum;
+    
+    fseeko(file, 0, SEEK_END);
+    long long partSize = ftello(file);
+    
+    OEInt videoListSize = 4 + (8 + 56) + (8 + 40);
+    OEInt audioListSize = 4 + (8 + 56) + (8 + 18);
+    OEInt headerListSize = 4 + (8 + 56) + (8 + videoListSize);
+    if (hasAudio)
+        headerListSize += 8 + audioListSize;
+    
+    fseeko(file, 0, SEEK_SET);
+    
+    writeFourCC(file, "RIFF");
+    writeLE32(file, (OEInt) (partSize > 8 ? partSize - 8 : 0));
+    writeFourCC(file, "AVI ");
+    
+    writeFourCC(file, "LIST");
+    writeLE32(file, headerListSize);
+    writeFourCC(file, "hdrl");
+    
+    writeFourCC(file, "avih");
+    writeLE32(file, 56);
+    writeLE32(file, 1000000 / CANVASVIDEORECORDER_FRAMERATE);
+    writeLE32(file, 0);
+    writeLE32(file, 0);
+    writeLE32(file, AVIF_HASINDEX);
+    writeLE32(file, videoFrameNum);
+    writeLE32(file, 0);
+    writeLE32(file, hasAudio ? 2 : 1);
+    writeLE32(file, (OEInt) part->maxChunkSize);
+    writeLE32(file, width);
+    writeLE32(file, height);
+    for (int i = 0; i < 4; i++)
+        writeLE32(file, 0);
+    
+    // Video stream
+    writeFourCC(file, "LIST");
+    writeLE32(file, videoListSize);
+    writeFourCC(file, "strl");
+    
+    writeFourCC(file, "strh");
+    writeLE32(file, 56);
+    writeFourCC(file, "vids");
+    writeFourCC(file, "MPNG");
+    writeLE32(file, 0);
+    writeLE32(file, 0);
+    writeLE32(file, 0);
+    writeLE32(file, 1);
+    writeLE32(file, CANVASVIDEORECORDER_FRAMERATE);
+    writeLE32(file, 0);
+    writeLE32(file, videoFrameNum);
+    writeLE32(file, (OEInt) part->maxChunkSize);
+    writeLE32(file, 0xffffffff);
+    writeLE32(file, 0);
+    writeLE16(file, 0);
+    writeLE16(file, 0);
+    writeLE16(file, width);
+    writeLE16(file, height);
+    
+    writeFourCC(file, "strf");
+    writeLE32(file, 40);
+    writeLE32(file, 40);
+    writeLE32(file, width);
+    writeLE32(file, height);
+    writeLE16(file, 1);
+    writeLE16(file, 24);
+    writeFourCC(file, "MPNG");
+    writeLE32(file, width * height * 3);
+    for (int i = 0; i < 4; i++)
+        writeLE32(file, 0);
+    
+    // Audio stream
+    if (hasAudio)
+    {
+        CanvasVideoAudio noAudio = {1, 2, 44100, 4, 16, NULL, 0};
+        if (!audio)
+            audio = &noAudio;
+        
+        writeFourCC(file, "LIST");
+        writeLE32(file, audioListSize);
+        writeFourCC(file, "strl");
+        
+        writeFourCC(file, "strh");
+        writeLE32(file, 56);
+        writeFourCC(file, "auds");
+        writeLE32(file, 0);
+        writeLE32(file, 0);
+        writeLE32(file, 0);
+        writeLE32(file, 0);
+        writeLE32(file, audio->blockAlign);
+        writeLE32(file, audio->sampleRate * audio->blockAlign);
+        writeLE32(file, 0);
+        writeLE32(file, audio->size / audio->blockAlign);
+        writeLE32(file, AVI_AUDIOCHUNK_SIZE);
+        writeLE32(file, 0xffffffff);
+        writeLE32(file, audio->blockAlign);
+        for (int i = 0; i < 4; i++)
+            writeLE16(file, 0);
+        
+        writeFourCC(file, "strf");
+        writeLE32(file, 18);
+        writeLE16(file, audio->formatTag);
+        writeLE16(file, audio->channelNum);
+        writeLE32(file, audio->sampleRate);
+        writeLE32(file, audio->sampleRate * audio->blockAlign);
+        writeLE16(file, audio->blockAlign);
+        writeLE16(file, audio->bitsPerSample);
+        writeLE16(file, 0);
+    }
+    
+    // The movi list size is fixed once the recording is closed
+    writeFourCC(file, "LIST");
+    writeLE32(file, (OEInt) (part->moviEnd ? part->moviEnd - part->moviOffset : 0));
+    part->moviOffset = ftello(file);
+    writeFourCC(file, "movi");
+}
+
+// Continuation files are named "Name 2.avi", "Name 3.avi" and so on
+- (BOOL)openPart
+{
+    CanvasVideoParts *theParts = (CanvasVideoParts *)parts;
+    
+    NSString *partPath = path;
+    if (!theParts->empty())
+        partPath = [NSString stringWithFormat:@"%@ %ld.%@",
+                    [path stringByDeletingPathExtension],
+                    (long) theParts->size() + 1,
+                    [path pathExtension]];
+    
+    file = fopen([partPath fileSystemRepresentation], "wb");
+    if (!file)
+        return NO;
+    
+    CanvasVideoPart part;
+    part.path = [partPath fileSystemRepresentation];
+    part.moviOffset = 0;
+    part.moviEnd = 0;
+    part.startFrame = 0;
+    part.frameNum = 0;
+    part.maxChunkSize = 0;
+    if (!theParts->empty())
+        part.startFrame = theParts->back().startFrame + theParts->back().frameNum;
+    theParts->push_back(part);
+    
+    [self writeHeaders:&theParts->back() audio:NULL];
+    
+    fileSize += ftello(file);
+    
+    return YES;
+}
+
+// Called from the encoder thread when the next chunk would not fit. The
+// finished file only lacks its audio, index and sizes, written on close.
+- (void)rollOver:(OEInt)chunkSize
+{
+    if (!file)
+        return;
+    
+    CanvasVideoPart& part = ((CanvasVideoParts *)parts)->back();
+    
+    long long reserve = (part.index.size() + 1) * 16 + 8;
+    if (audioPath)
+    {
+        long long audioSize = ((part.frameNum + 1) * AVI_AUDIORESERVE /
+                               CANVASVIDEORECORDER_FRAMERATE);
+        reserve += audioSize + (audioSize / AVI_AUDIOCHUNK_SIZE + 1) * 24;
+    }
+    
+    if (ftello(file) + 8 + chunkSize + reserve <= AVI_MAXFILESIZE)
+        return;
+    
+    part.moviEnd = ftello(file);
+    
+    fclose(file);
+    file = NULL;
+    
+    if (![self openPart])
+        NSLog(@"Video recording: could not open a continuation file, "
+              "recording stopped");
+}
+
+- (BOOL)open
+{
+    // Record audio along if the recorder is free; the headers depend on it
+    PAAudio *theAudio = (PAAudio *)paAudio;
+    if (theAudio && !theAudio->isRecorderRecording())
+    {
+        NSString *thePath = [NSTemporaryDirectory()
+                             stringByAppendingPathComponent:@"oevideorecording"];
+        audioPath = [thePath copy];
+    }
+    
+    if (![self openPart])
+    {
+        [audioPath release];
+        audioPath = nil;
+        
+        return NO;
+    }
+    
+    if (audioPath)
+    {
+        theAudio->openRecorder([audioPath cppString]);
+        theAudio->startRecorder();
+    }
+    
+    startTime = CFAbsoluteTimeGetCurrent();
+    
+    [NSThread detachNewThreadSelector:@selector(encodeFrames:)
+                             toTarget:self
+                           withObject:nil];
+    
+    return YES;
+}
+
+// Called from the display link thread with the canvas context current.
+// Only copies the frame into a free slot, so its cost is constant; when
+// the encoder falls behind, frames are dropped instead of waited on.
+- (void)captureFrame
+{
+    if (!file || stopRequested)
+        return;
+    
+    if (!width)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        
+        if (!viewport[2] || !viewport[3])
+            return;
+        
+        for (int i = 0; i < CANVASVIDEORECORDER_SLOTNUM; i++)
+            slots[i].pixels = (unsigned char *)malloc(viewport[2] * viewport[3] * 4);
+        
+        height = viewport[3];
+        OSMemoryBarrier();
+        width = viewport[2];
+    }
+    
+    frameNum++;
+    
+    if ((head - tail) >= CANVASVIDEORECORDER_SLOTNUM)
+    {
+        droppedFrameNum++;
+        
+        return;
+    }
+    
+    CanvasVideoFrame *frame = &slots[head % CANVASVIDEORECORDER_SLOTNUM];
+    frame->time = CFAbsoluteTimeGetCurrent();
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame->pixels);
+    
+    OSAtomicIncrement32Barrier(&head);
+    
+    dispatch_semaphore_signal(frameSemaphore);
+}
+
+- (void)encodeFrame:(CanvasVideoFrame *)frame
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    NSBitmapImageRep *rep;
+    rep = [[[NSBitmapImageRep alloc] initWithBitmapDataPlanes:NULL
+                                                   pixelsWide:width
+                                                   pixelsHigh:height
+                                                bitsPerSample:8
+                                              samplesPerPixel:3
+                                                     hasAlpha:NO
+                                                     isPlanar:NO
+                                               colorSpaceName:NSDeviceRGBColorSpace
+                                                  bytesPerRow:width * 3
+                                                 bitsPerPixel:24]
+           autorelease];
+    
+    // OpenGL rows are bottom-up
+    unsigned char *dest = [rep bitmapData];
+    for (int y = height - 1; y >= 0; y--)
+    {
+        unsigned char *src = frame->pixels + y * width * 4;
+        for (int x = 0; x < width; x++, src += 4, dest += 3)
+        {
+            dest[0] = src[0];
+            dest[1] = src[1];
+            dest[2] = src[2];
+        }
+    }
+    
+    NSData *data = [rep representationUsingType:NSPNGFileType
+                                     properties:[NSDictionary dictionary]];
+    
+    [self rollOver:(OEInt) [data length]];
+    
+    [self writeChunk:"00dc"
+                data:[data bytes]
+                size:(OEInt) [data length]
+               flags:AVIIF_KEYFRAME];
+    
+    [pool drain];
+}
+
+- (void)encodeFrames:(id)object
+{
+    long long lastFrameIndex = -1;
+    
+    while (1)
+    {
+        dispatch_semaphore_wait(frameSemaphore, DISPATCH_TIME_FOREVER);
+        
+        while (tail != head)
+        {
+            CanvasVideoFrame *frame = &slots[tail % CANVASVIDEORECORDER_SLOTNUM];
+            
+            // Frames are only captured when the canvas changes; unchanged
+            // frames are stored as empty chunks to keep the frame rate
+            long long frameIndex = (long long) ((frame->time - startTime) *
+                                                CANVASVIDEORECORDER_FRAMERATE + 0.5);
+            if (frameIndex <= lastFrameIndex)
+                frameIndex = lastFrameIndex + 1;
+            
+            for (long long i = lastFrameIndex + 1; i < frameIndex; i++)
+            {
+                [self rollOver:0];
+                [self writeChunk:"00dc" data:NULL size:0 flags:0];
+            }
+            
+            [self encodeFrame:frame];
+            
+            lastFrameIndex = frameIndex;
+            
+            OSAtomicIncrement32Barrier(&tail);
+        }
+        
+        if (stopRequested && (tail == head))
+            break;
+    }
+    
+    dispatch_semaphore_signal(finishSemaphore);
+}
+
+- (void)writeAudio:(CanvasVideoAudio *)audio
+              part:(CanvasVideoPart&)part
+{
+    OEInt chunkSize = AVI_AUDIOCHUNK_SIZE - AVI_AUDIOCHUNK_SIZE % audio->blockAlign;
+    
+    for (OEInt offset = 0; offset < audio->size; offset += chunkSize)
+    {
+        OEInt size = audio->size - offset;
+        if (size > chunkSize)
+            size = chunkSize;
+        
+        [self writeChunk:"01wb"
+                    data:audio->data + offset
+                    size:size
+                   flags:AVIIF_KEYFRAME
+                    part:part];
+    }
+}
+
+// Writes the audio of the part's time span, the index and the sizes
+- (void)finishPart:(CanvasVideoPart *)part
+             audio:(CanvasVideoAudio *)audio
+            isLast:(BOOL)isLast
+{
+    fseeko(file, part->moviEnd, SEEK_SET);
+    
+    CanvasVideoAudio partAudio;
+    if (audio)
+    {
+        OEInt byteRate = audio->sampleRate * audio->blockAlign;
+        long long start = part->startFrame * byteRate / CANVASVIDEORECORDER_FRAMERATE;
+        long long end = ((part->startFrame + part->frameNum) * byteRate /
+                         CANVASVIDEORECORDER_FRAMERATE);
+        start -= start % audio->blockAlign;
+        end -= end % audio->blockAlign;
+        if (isLast || (end > audio->size))
+            end = audio->size;
+        if (start > end)
+            start = end;
+        
+        partAudio = *audio;
+        partAudio.data = audio->data + start;
+        partAudio.size = (OEInt) (end - start);
+        
+        [self writeAudio:&partAudio part:*part];
+    }
+    
+    part->moviEnd = ftello(file);
+    
+    // Index
+    writeFourCC(file, "idx1");
+    writeLE32(file, (OEInt) (part->index.size() * 16));
+    for (CanvasVideoIndex::iterator i = part->index.begin();
+         i != part->index.end();
+         i++)
+    {
+        writeFourCC(file, i->chunkId);
+        writeLE32(file, i->flags);
+        writeLE32(file, i->offset);
+        writeLE32(file, i->size);
+    }
+    
+    fileSize += 8 + part->index.size() * 16;
+    
+    [self writeHeaders:part audio:(audio ? &partAudio : NULL)];
+}
+
+- (void)close
+{
+    CanvasVideoParts *theParts = (CanvasVideoParts *)parts;
+    if (theParts->empty())
+        return;
+    
+    stopRequested = YES;
+    dispatch_semaphore_signal(frameSemaphore);
+    dispatch_semaphore_wait(finishSemaphore, DISPATCH_TIME_FOREVER);
+    
+    // Mux the audio recording
+    CanvasVideoAudio audio;
+    BOOL hasAudioData = NO;
+    NSData *wav = nil;
+    
+    if (audioPath)
+    {
+        ((PAAudio *)paAudio)->closeRecorder();
+        
+        wav = [[NSData alloc] initWithContentsOfMappedFile:audioPath];
+        if (wav && parseWAV(wav, audio))
+            hasAudioData = YES;
+    }
+    
+    // Only the last file is still open; if a continuation file could not
+    // be created, the previous one is finished like the others
+    if (file)
+    {
+        theParts->back().moviEnd = ftello(file);
+        
+        fclose(file);
+        file = NULL;
+    }
+    
+    for (CanvasVideoParts::iterator i = theParts->begin();
+         i != theParts->end();
+         i++)
+    {
+        file = fopen(i->path.c_str(), "r+b");
+        if (!file)
+            continue;
+        
+        [self finishPart:&(*i)
+                   audio:(hasAudioData ? &audio : NULL)
+                  isLast:((i + 1) == theParts->end())];
+        
+        fclose(file);
+        file = NULL;
+    }
+    
+    [wav release];
+    
+    if (audioPath)
+        [[NSFileManager defaultManager] removeItemAtPath:audioPath
+                                                   error:nil];
+    
+    if ([[NSUserDefaults standardUserDefaults] boolForKey:@"OEDebugRenderStatistics"])
+        NSLog(@"Video recording: %lld frames captured, %lld dropped, "
+              "%lld bytes in %ld files",
+              frameNum, droppedFrameNum, fileSize, (long) theParts->size());
+    
+    theParts->clear();
+}
+
+- (NSString *)path
+{
+    return path;
+}
+
+- (NSInteger)backlog
+{
+    return head - tail;
+}
+
+- (long long)frameNum
+{
+    return frameNum;
+}
+
+- (long long)droppedFrameNum
+{
+    return droppedFrameNum;
+}
+
+- (long long)fileSize
+{
+    return fileSize;
+}
+
+@end
@@ -16,6 +16,19 @@
 #define DEVICE_KEYMAP_SIZE		256
 #define DEVICE_MOUSE_BUTTONNUM	8
 
+// Rendering of canvases that are not visible or not focused
+typedef enum
+{
+    CANVASVIEW_BACKGROUND_RENDER,
+    CANVASVIEW_BACKGROUND_SKIPHIDDEN,
+    CANVASVIEW_BACKGROUND_THROTTLEUNFOCUSED,
+} CanvasViewBackgroundPolicy;
+
+#define CANVASVIEW_THROTTLE_DIVIDER 4
+
+@class CanvasVideoRecorder;
+@class RemoteDisplayServer;
+
 @interface CanvasView : NSOpenGLView
 <NSTextInputClient>
 {
@@ -30,11 +43,24 @@
     int keyModifierFlags;
     int keyboardLEDs;
     BOOL capsLockNotSynchronized;
+    
+    CanvasVideoRecorder *videoRecorder;
+    RemoteDisplayServer *remoteDisplayServer;
+    
+    volatile int backgroundPolicy;
+    volatile BOOL windowOccluded;
+    volatile BOOL windowUnfocused;
+    long long tickNum;
+    long long vsyncNum;
+    long long skippedFrameNum;
+    double vsyncTime;
+    double openTime;
 }
 
 - (void)windowDidResize;
 - (void)windowDidBecomeKey;
 - (void)windowDidResignKey;
+- (void)windowDidChangeVisibility;
 
 - (void)initOpenGL;
 - (void)freeOpenGL;
@@ -47,11 +73,18 @@
 - (BOOL)isPaperCanvas;
 - (NSSize)defaultViewSize;
 - (void)vsync;
+- (long long)skippedFrameNum;
+- (double)savedRenderTime;
+- (double)openTime;
 
 - (NSSize)canvasSize;
 - (NSSize)canvasPixelDensity;
 - (NSSize)pageSize;
 - (NSImage *)canvasImage:(NSRect)rect;
+- (NSBitmapImageRep *)canvasBitmap:(NSRect)rect;
+
+- (void)setVideoRecorder:(CanvasVideoRecorder *)theVideoRecorder;
+- (void)setRemoteDisplayServer:(RemoteDisplayServer *)theRemoteDisplayServer;
 
 - (void)setKeyboardLEDs:(int)theKeyboardLEDs;
 - (void)synchronizeKeyboardLEDs;
@@ -15,6 +15,10 @@
 #import "NSStringAdditions.h"
 
 #import "CanvasWindowController.h"
+#import "CanvasVideoRecorder.h"
+#import "RemoteDisplayServer.h"
+#import "OpenGLResourcePool.h"
+#import "InputRecorder.h"
 #import "Application.h"
 #import "DocumentController.h"
 
@@ -83,26 +87,10 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 
 - (id)initWithFrame:(NSRect)rect
 {
-    NSOpenGLPixelFormatAttribute pixelFormatAtrributes[] =
-    {
-        NSOpenGLPFADoubleBuffer,
-        NSOpenGLPFADepthSize,
-        32,
-        0
-    };
-    
-    NSOpenGLPixelFormat *pixelFormat;
-    pixelFormat = [[NSOpenGLPixelFormat alloc]
-                   initWithAttributes:pixelFormatAtrributes];
+    NSOpenGLPixelFormat *pixelFormat = [[OpenGLResourcePool sharedPool] pixelFormat];
     
     if (!pixelFormat)
-    {
-        NSLog(@"Cannot create NSOpenGLPixelFormat");
-        
         return nil;
-    }
-    
-    [pixelFormat autorelease];
     
     self = [super initWithFrame:rect pixelFormat:pixelFormat];
     
@@ -232,10 +220,15 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
     [userDefaults removeObserver:self
                       forKeyPath:@"OEVideoEnableShader"];
+    [userDefaults removeObserver:self
+                      forKeyPath:@"OEVideoBackgroundPolicy"];
     
     if (displayLink)
         CVDisplayLinkRelease(displayLink);
     
+    [videoRecorder release];
+    [remoteDisplayServer release];
+    
     [super dealloc];
 }
 
@@ -253,6 +246,13 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
                       options:NSKeyValueObservingOptionNew
                       context:nil];
     
+    backgroundPolicy = (int) [userDefaults integerForKey:@"OEVideoBackgroundPolicy"];
+    windowUnfocused = ![[self window] isKeyWindow];
+    [userDefaults addObserver:self
+                   forKeyPath:@"OEVideoBackgroundPolicy"
+                      options:NSKeyValueObservingOptionNew
+                      context:nil];
+    
     [self registerForDraggedTypes:[NSArray arrayWithObjects:
                                    NSStringPboardType,
                                    NSFilenamesPboardType, 
@@ -348,6 +348,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     Document *document = [canvasWindowController document];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
+    windowUnfocused = NO;
+    
     if (!canvas)
         return;
     
@@ -381,6 +383,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     Document *document = [canvasWindowController document];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
+    windowUnfocused = YES;
+    
     if (!canvas)
         return;
     
@@ -398,6 +402,25 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
             [self removeTrackingArea:area];*/
 }
 
+// Input recording
+
+// The recorder is optional, so callers check the result
+- (InputRecorder *)inputRecorder
+{
+    CanvasWindowController *canvasWindowController = [[self window] windowController];
+    
+    return (InputRecorder *)[[canvasWindowController document] inputRecorder];
+}
+
+// Live input is ignored while a recording is replayed. Replays are armed
+// before the emulation runs and only stop later, so no lock is needed.
+- (BOOL)isInputReplaying
+{
+    InputRecorder *inputRecorder = [self inputRecorder];
+    
+    return (inputRecorder && inputRecorder->isReplaying());
+}
+
 // Drag and drop
 
 - (NSDragOperation)draggingEntered:(id <NSDraggingInfo>)sender
@@ -448,9 +471,10 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     {
         CanvasWindowController *canvasWindowController = [[self window] windowController];
         Document *document = [canvasWindowController document];
+        InputRecorder *inputRecorder = [self inputRecorder];
         OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
         
-        if (!canvas)
+        if (!canvas || [self isInputReplaying])
             return NO;
         
         wstring clipboard = [[pasteboard stringForType:NSStringPboardType] cppWString];
@@ -458,6 +482,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
         [document lockEmulation];
         
         canvas->doPaste(clipboard);
+        if (inputRecorder)
+            inputRecorder->recordPaste(canvas, clipboard);
         
         [document unlockEmulation];
         
@@ -482,6 +508,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     
     if ([keyPath isEqualToString:@"OEVideoEnableShader"])
         canvas->setEnableShader([theObject boolValue]);
+    else if ([keyPath isEqualToString:@"OEVideoBackgroundPolicy"])
+        backgroundPolicy = [theObject intValue];
 }
 
 // Drawing
@@ -500,8 +528,12 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     
     [[self openGLContext] makeCurrentContext];
     
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
     canvas->open(setCapture, setKeyboardLEDs, self);
     
+    openTime = CFAbsoluteTimeGetCurrent() - startTime;
+    
     [NSOpenGLContext clearCurrentContext];
     
     if (CVDisplayLinkCreateWithActiveCGDisplays(&displayLink) == kCVReturnSuccess)
@@ -678,8 +710,98 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
                             waitUntilDone:NO];
     canvasSize = NSMakeSize(newCanvasSize.width, newCanvasSize.height);
     
-    if (canvas->vsync())
-        [[self openGLContext] flushBuffer];
+    // Video capture and remote displays need every frame, whatever the policy
+    BOOL isSkipped = NO;
+    if (!videoRecorder && ![remoteDisplayServer clientNum])
+    {
+        if ((backgroundPolicy != CANVASVIEW_BACKGROUND_RENDER) && windowOccluded)
+            isSkipped = YES;
+        else if ((backgroundPolicy == CANVASVIEW_BACKGROUND_THROTTLEUNFOCUSED) &&
+                 windowUnfocused && (tickNum % CANVASVIEW_THROTTLE_DIVIDER))
+            isSkipped = YES;
+    }
+    
+    tickNum++;
+    
+    if (isSkipped)
+        skippedFrameNum++;
+    else
+    {
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        
+        if (canvas->vsync())
+        {
+            [videoRecorder captureFrame];
+            [remoteDisplayServer captureFrame];
+            
+            [[self openGLContext] flushBuffer];
+        }
+        else if ([remoteDisplayServer isFrameRequested])
+        {
+            // A viewer that connects to an idle canvas needs the current frame
+            canvas->draw();
+            
+            [remoteDisplayServer captureFrame];
+            
+            [[self openGLContext] flushBuffer];
+        }
+        
+        vsyncNum++;
+        vsyncTime += CFAbsoluteTimeGetCurrent() - startTime;
+    }
+    
+    [self leaveContext];
+}
+
+- (void)windowDidChangeVisibility
+{
+    NSWindow *window = [self window];
+    
+    BOOL isVisible = [window isVisible] && ![window isMiniaturized];
+    if ([window respondsToSelector:@selector(occlusionState)])
+        isVisible = isVisible && ([window occlusionState] & NSWindowOcclusionStateVisible);
+    
+    // Skipped frames may have left the view stale
+    if (windowOccluded && isVisible)
+        [self setNeedsDisplay:YES];
+    
+    windowOccluded = !isVisible;
+}
+
+- (long long)skippedFrameNum
+{
+    return skippedFrameNum;
+}
+
+- (double)savedRenderTime
+{
+    if (!vsyncNum)
+        return 0;
+    
+    return skippedFrameNum * vsyncTime / vsyncNum;
+}
+
+- (double)openTime
+{
+    return openTime;
+}
+
+- (void)setVideoRecorder:(CanvasVideoRecorder *)theVideoRecorder
+{
+    [self enterContext];
+    
+    [videoRecorder release];
+    videoRecorder = [theVideoRecorder retain];
+    
+    [self leaveContext];
+}
+
+- (void)setRemoteDisplayServer:(RemoteDisplayServer *)theRemoteDisplayServer
+{
+    [self enterContext];
+    
+    [remoteDisplayServer release];
+    remoteDisplayServer = [theRemoteDisplayServer retain];
     
     [self leaveContext];
 }
@@ -772,6 +894,58 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     return theImage;
 }
 
+- (NSBitmapImageRep *)canvasBitmap:(NSRect)rect
+{
+    CanvasWindowController *canvasWindowController = [[self window] windowController];
+    OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
+    
+    if (!canvas)
+        return nil;
+    
+    [self enterContext];
+    
+    OEImage image = canvas->getImage(OEMakeRect((float) rect.origin.x,
+                                                (float) rect.origin.y,
+                                                (float) rect.size.width,
+                                                (float) rect.size.height));
+    
+    [self leaveContext];
+    
+    OESize size = image.getSize();
+    NSInteger bytesPerPixel = image.getBytesPerPixel();
+    NSInteger bytesPerRow = image.getBytesPerRow();
+    
+    if (!size.width || !size.height)
+        return nil;
+    
+    // Unlike canvasImage:, the pixels are copied so the bitmap
+    // can outlive the canvas image and be used on other threads.
+    // Canvas rows are bottom-up, bitmap rows top-down.
+    NSBitmapImageRep *rep;
+    rep = [[[NSBitmapImageRep alloc] initWithBitmapDataPlanes:NULL
+                                                   pixelsWide:size.width
+                                                   pixelsHigh:size.height
+                                                bitsPerSample:8
+                                              samplesPerPixel:bytesPerPixel
+                                                     hasAlpha:(bytesPerPixel == 4)
+                                                     isPlanar:NO
+                                               colorSpaceName:NSCalibratedRGBColorSpace
+                                                 bitmapFormat:0
+                                                  bytesPerRow:bytesPerRow
+                                                 bitsPerPixel:8 * bytesPerPixel]
+           autorelease];
+    
+    NSInteger height = (NSInteger) size.height;
+    unsigned char *pixels = image.getPixels();
+    unsigned char *data = [rep bitmapData];
+    for (NSInteger y = 0; y < height; y++)
+        memcpy(data + y * bytesPerRow,
+               pixels + (height - 1 - y) * bytesPerRow,
+               bytesPerRow);
+    
+    return rep;
+}
+
 // Keyboard
 
 - (int)getUsageId:(int)keyCode
@@ -788,14 +962,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->sendUnicodeChar((CanvasUnicodeChar)unicode);
+    if (inputRecorder)
+        inputRecorder->recordUnicodeChar(canvas, unicode);
     
     [document unlockEmulation];
 }
@@ -806,9 +983,10 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     if ((flags & mask) == (keyModifierFlags & mask))
@@ -819,6 +997,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     [document lockEmulation];
     
     canvas->setKey(usageId, value);
+    if (inputRecorder)
+        inputRecorder->recordKey(canvas, usageId, value);
     
     [document unlockEmulation];
 }
@@ -826,9 +1006,10 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 - (void)synchronizeKeyboardLEDs
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     CGEventRef event = CGEventCreate(NULL);
@@ -845,6 +1026,11 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
             
             canvas->setKey(CANVAS_K_CAPSLOCK, true);
             canvas->setKey(CANVAS_K_CAPSLOCK, false);
+            if (inputRecorder)
+            {
+                inputRecorder->recordKey(canvas, CANVAS_K_CAPSLOCK, true);
+                inputRecorder->recordKey(canvas, CANVAS_K_CAPSLOCK, false);
+            }
         }
     }
     else
@@ -862,9 +1048,10 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     if (![theEvent isARepeat])
@@ -874,6 +1061,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
         [document lockEmulation];
         
         canvas->setKey(usageId, true);
+        if (inputRecorder)
+            inputRecorder->recordKey(canvas, usageId, true);
         
         [document unlockEmulation];
     }
@@ -891,9 +1080,10 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     int usageId = [self getUsageId:[theEvent keyCode]];
@@ -901,6 +1091,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     [document lockEmulation];
     
     canvas->setKey(usageId, false);
+    if (inputRecorder)
+        inputRecorder->recordKey(canvas, usageId, false);
     
     [document unlockEmulation];
 }
@@ -943,14 +1135,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->enterMouse();
+    if (inputRecorder)
+        inputRecorder->recordMouseEnter(canvas);
     
     [document unlockEmulation];
 }
@@ -959,14 +1154,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->exitMouse();
+    if (inputRecorder)
+        inputRecorder->recordMouseExit(canvas);
     
     [document unlockEmulation];
 }
@@ -975,19 +1173,28 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     NSPoint position = [self convertPoint:[theEvent locationInWindow]
                                  fromView:nil];
+    float x = (float) (position.x / NSWidth([self bounds]));
+    float y = (float) (position.y / NSHeight([self bounds]));
+    float rx = (float) [theEvent deltaX];
+    float ry = (float) [theEvent deltaY];
     
     [document lockEmulation];
     
-    canvas->setMousePosition((float) (position.x / NSWidth([self bounds])),
-                             (float) (position.y / NSHeight([self bounds])));
-    canvas->moveMouse((float) [theEvent deltaX], (float) [theEvent deltaY]);
+    canvas->setMousePosition(x, y);
+    canvas->moveMouse(rx, ry);
+    if (inputRecorder)
+    {
+        inputRecorder->recordMousePosition(canvas, x, y);
+        inputRecorder->recordMouseMove(canvas, rx, ry);
+    }
     
     [document unlockEmulation];
 }
@@ -1011,14 +1218,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->setMouseButton(0, true);
+    if (inputRecorder)
+        inputRecorder->recordMouseButton(canvas, 0, true);
     
     [document unlockEmulation];
 }
@@ -1027,14 +1237,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->setMouseButton(0, false);
+    if (inputRecorder)
+        inputRecorder->recordMouseButton(canvas, 0, false);
     
     [document unlockEmulation];
 }
@@ -1043,14 +1256,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->setMouseButton(1, true);
+    if (inputRecorder)
+        inputRecorder->recordMouseButton(canvas, 1, true);
     
     [document unlockEmulation];
 }
@@ -1059,14 +1275,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->setMouseButton(1, false);
+    if (inputRecorder)
+        inputRecorder->recordMouseButton(canvas, 1, false);
     
     [document unlockEmulation];
 }
@@ -1075,14 +1294,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->setMouseButton((int) [theEvent buttonNumber], true);
+    if (inputRecorder)
+        inputRecorder->recordMouseButton(canvas, (int) [theEvent buttonNumber], true);
     
     [document unlockEmulation];
 }
@@ -1091,14 +1313,17 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     [document lockEmulation];
     
     canvas->setMouseButton((int) [theEvent buttonNumber], false);
+    if (inputRecorder)
+        inputRecorder->recordMouseButton(canvas, (int) [theEvent buttonNumber], false);
     
     [document unlockEmulation];
 }
@@ -1107,6 +1332,7 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
     if (!canvas)
@@ -1115,12 +1341,23 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     if ([self isPaperCanvas])
         return [super scrollWheel:theEvent];
     
+    if ([self isInputReplaying])
+        return;
+    
     [document lockEmulation];
     
     if ([theEvent deltaX])
+    {
         canvas->sendMouseWheelEvent(0, (float) [theEvent deltaX]);
+        if (inputRecorder)
+            inputRecorder->recordMouseWheel(canvas, 0, (float) [theEvent deltaX]);
+    }
     if ([theEvent deltaY])
+    {
         canvas->sendMouseWheelEvent(1, (float) [theEvent deltaY]);
+        if (inputRecorder)
+            inputRecorder->recordMouseWheel(canvas, 1, (float) [theEvent deltaY]);
+    }
     
     [document unlockEmulation];
 }
@@ -1180,9 +1417,10 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
 {
     CanvasWindowController *canvasWindowController = [[self window] windowController];
     Document *document = [canvasWindowController document];
+    InputRecorder *inputRecorder = [self inputRecorder];
     OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
     
-    if (!canvas)
+    if (!canvas || [self isInputReplaying])
         return;
     
     if (!text)
@@ -1191,6 +1429,8 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink,
     [document lockEmulation];
     
     canvas->doPaste([text cppWString]);
+    if (inputRecorder)
+        inputRecorder->recordPaste(canvas, [text cppWString]);
     
     [document unlockEmulation];
 }
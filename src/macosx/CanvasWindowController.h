@@ -11,6 +11,9 @@
 #import <Cocoa/Cocoa.h>
 
 #import "CanvasView.h"
+#import "CanvasPDFWriter.h"
+#import "CanvasVideoRecorder.h"
+#import "RemoteDisplayServer.h"
 
 @interface CanvasWindowController : NSWindowController
 <NSToolbarDelegate, NSWindowDelegate>
@@ -22,6 +25,15 @@
     void *device;
     NSString *title;
     void *canvas;
+    
+    CanvasPDFWriter *pdfWriter;
+    NSTimer *pdfWriterTimer;
+    
+    CanvasVideoRecorder *videoRecorder;
+    NSTimer *videoRecorderTimer;
+    
+    RemoteDisplayServer *remoteDisplayServer;
+    NSTimer *remoteDisplayTimer;
 }
 
 - (id)initWithDevice:(void *)theDevice
@@ -36,4 +48,8 @@
 - (IBAction)setDoubleSize:(id)sender;
 - (IBAction)fitToScreen:(id)sender;
 
+- (IBAction)togglePDFOutput:(id)sender;
+- (IBAction)toggleVideoCapture:(id)sender;
+- (IBAction)toggleRemoteDisplay:(id)sender;
+
 @end
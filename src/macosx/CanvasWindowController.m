@@ -10,6 +10,7 @@
 
 #import "CanvasWindowController.h"
 #import "CanvasWindow.h"
+#import "DocumentController.h"
 
 @implementation CanvasWindowController
 
@@ -94,6 +95,10 @@
     
     [window setAcceptsMouseMovedEvents:YES];
     [window setAllowsConcurrentViewDrawing:YES];
+    
+    if ([fCanvasView isDisplayCanvas] &&
+        [[NSUserDefaults standardUserDefaults] boolForKey:@"OERemoteDisplayAutoStart"])
+        [self startRemoteDisplay];
 }
 
 - (void)showWindow:(id)sender
@@ -109,6 +114,10 @@
     
     [window leaveFullscreen];
     
+    [self stopPDFOutput];
+    [self stopVideoCapture];
+    [self stopRemoteDisplay];
+    
     if ([self isWindowLoaded])
     {
         [fCanvasView stopDisplayLink];
@@ -173,6 +182,12 @@
         return !fullscreen;
     else if ([anItem action] == @selector(runToolbarCustomizationPalette:))
         return !fullscreen;
+    else if ([anItem action] == @selector(togglePDFOutput:))
+        return [fCanvasView isPaperCanvas];
+    else if ([anItem action] == @selector(toggleVideoCapture:))
+        return [fCanvasView isDisplayCanvas];
+    else if ([anItem action] == @selector(toggleRemoteDisplay:))
+        return [fCanvasView isDisplayCanvas];
     
     return YES;
 }
@@ -266,6 +281,17 @@
         [item setImage:[NSImage imageNamed:@"IconRevert.png"]];
         [item setAction:@selector(revertDocumentToSaved:)];
     }
+    else if ([ident isEqualToString:@"Fork"])
+    {
+        [item setLabel:NSLocalizedString(@"Fork",
+                                         @"Canvas Toolbar Label.")];
+        [item setPaletteLabel:NSLocalizedString(@"Fork",
+                                                @"Canvas Toolbar Palette Label.")];
+        [item setToolTip:NSLocalizedString(@"Open an independent copy of the running emulation.",
+                                           @"Canvas Toolbar Tool Tip.")];
+        [item setImage:[NSImage imageNamed:NSImageNameMultipleDocuments]];
+        [item setAction:@selector(forkDocument:)];
+    }
     else if ([ident isEqualToString:@"AudioControls"])
     {
         [item setLabel:NSLocalizedString(@"Audio Controls",
@@ -289,6 +315,61 @@
         [item setAction:@selector(showEmulation:)];
         [item setVisibilityPriority:NSToolbarItemVisibilityPriorityHigh];
     }
+    else if ([ident isEqualToString:@"PDF Output"])
+    {
+        [item setLabel:NSLocalizedString(@"PDF Output",
+                                         @"Canvas Toolbar Label.")];
+        [item setPaletteLabel:NSLocalizedString(@"PDF Output",
+                                                @"Canvas Toolbar Palette Label.")];
+        [item setToolTip:NSLocalizedString(@"Start or stop saving printed pages to a PDF document.",
+                                           @"Canvas Toolbar Tool Tip.")];
+        [item setImage:[[NSWorkspace sharedWorkspace] iconForFileType:@"pdf"]];
+        [item setAction:@selector(togglePDFOutput:)];
+    }
+    else if ([ident isEqualToString:@"Video Capture"])
+    {
+        [item setLabel:NSLocalizedString(@"Video Capture",
+                                         @"Canvas Toolbar Label.")];
+        [item setPaletteLabel:NSLocalizedString(@"Video Capture",
+                                                @"Canvas Toolbar Palette Label.")];
+        [item setToolTip:NSLocalizedString(@"Start or stop recording video and audio.",
+                                           @"Canvas Toolbar Tool Tip.")];
+        [item setImage:[NSImage imageNamed:@"AudioRecord.png"]];
+        [item setAction:@selector(toggleVideoCapture:)];
+    }
+    else if ([ident isEqualToString:@"Remote Display"])
+    {
+        [item setLabel:NSLocalizedString(@"Remote Display",
+                                         @"Canvas Toolbar Label.")];
+        [item setPaletteLabel:NSLocalizedString(@"Remote Display",
+                                                @"Canvas Toolbar Palette Label.")];
+        [item setToolTip:NSLocalizedString(@"Start or stop serving this display to RFB (VNC) viewers.",
+                                           @"Canvas Toolbar Tool Tip.")];
+        [item setImage:[NSImage imageNamed:NSImageNameNetwork]];
+        [item setAction:@selector(toggleRemoteDisplay:)];
+    }
+    else if ([ident isEqualToString:@"Input Recording"])
+    {
+        [item setLabel:NSLocalizedString(@"Record Input",
+                                         @"Canvas Toolbar Label.")];
+        [item setPaletteLabel:NSLocalizedString(@"Record Input",
+                                                @"Canvas Toolbar Palette Label.")];
+        [item setToolTip:NSLocalizedString(@"Start or stop recording keyboard, mouse and joystick input.",
+                                           @"Canvas Toolbar Tool Tip.")];
+        [item setImage:[NSImage imageNamed:@"AudioRecord.png"]];
+        [item setAction:@selector(toggleInputRecording:)];
+    }
+    else if ([ident isEqualToString:@"Input Replay"])
+    {
+        [item setLabel:NSLocalizedString(@"Replay Input",
+                                         @"Canvas Toolbar Label.")];
+        [item setPaletteLabel:NSLocalizedString(@"Replay Input",
+                                                @"Canvas Toolbar Palette Label.")];
+        [item setToolTip:NSLocalizedString(@"Start or stop replaying recorded input.",
+                                           @"Canvas Toolbar Tool Tip.")];
+        [item setImage:[NSImage imageNamed:@"AudioPlay.png"]];
+        [item setAction:@selector(toggleInputReplay:)];
+    }
     [item autorelease];
     
     return item;
@@ -317,6 +398,12 @@
             @"Warm Restart",
             @"Debugger Break",
             @"Revert to Saved",
+            @"Fork",
+            @"PDF Output",
+            @"Video Capture",
+            @"Remote Display",
+            @"Input Recording",
+            @"Input Replay",
             @"AudioControls",
             @"Devices",
             NSToolbarSeparatorItemIdentifier,
@@ -347,6 +434,21 @@
     [fCanvasView windowDidResignKey];
 }
 
+- (void)windowDidMiniaturize:(NSNotification *)notification
+{
+    [fCanvasView windowDidChangeVisibility];
+}
+
+- (void)windowDidDeminiaturize:(NSNotification *)notification
+{
+    [fCanvasView windowDidChangeVisibility];
+}
+
+- (void)windowDidChangeOcclusionState:(NSNotification *)notification
+{
+    [fCanvasView windowDidChangeVisibility];
+}
+
 - (NSApplicationPresentationOptions)window:(NSWindow *)window
       willUseFullScreenPresentationOptions:(NSApplicationPresentationOptions)proposedOptions
 {
@@ -433,4 +535,237 @@
     [self scaleFrame:1E6F];
 }
 
+// PDF output
+
+- (void)pdfWriterTimerDidExpire:(NSTimer *)theTimer
+{
+    [pdfWriter update];
+}
+
+- (void)startPDFOutput:(NSString *)path
+{
+    pdfWriter = [[CanvasPDFWriter alloc] initWithCanvasView:fCanvasView
+                                                       path:path];
+    if (![pdfWriter open])
+    {
+        [pdfWriter release];
+        pdfWriter = nil;
+        
+        NSAlert *alert = [[NSAlert alloc] init];
+        [alert setMessageText:[NSString localizedStringWithFormat:
+                               @"The document \u201C%@\u201D could not be created.",
+                               [path lastPathComponent]]];
+        [alert setInformativeText:[NSString localizedStringWithFormat:
+                                   @"Try saving the document to another volume."]];
+        [alert runModal];
+        [alert release];
+        
+        return;
+    }
+    
+    pdfWriterTimer = [[NSTimer scheduledTimerWithTimeInterval:0.5
+                                                       target:self
+                                                     selector:@selector(pdfWriterTimerDidExpire:)
+                                                     userInfo:nil
+                                                      repeats:YES] retain];
+}
+
+- (void)stopPDFOutput
+{
+    [pdfWriterTimer invalidate];
+    [pdfWriterTimer release];
+    pdfWriterTimer = nil;
+    
+    [pdfWriter close];
+    [pdfWriter release];
+    pdfWriter = nil;
+}
+
+- (IBAction)togglePDFOutput:(id)sender
+{
+    if (pdfWriter)
+    {
+        [self stopPDFOutput];
+        
+        return;
+    }
+    
+    NSSavePanel *panel = [NSSavePanel savePanel];
+    [panel setAllowedFileTypes:[NSArray arrayWithObject:@"pdf"]];
+    [panel setAllowsOtherFileTypes:NO];
+    
+    if ([panel runModal] == NSOKButton)
+        [self startPDFOutput:[[panel URL] path]];
+}
+
+// Video capture
+
+- (void)videoRecorderTimerDidExpire:(NSTimer *)theTimer
+{
+    NSString *toolTip = [NSString localizedStringWithFormat:
+                         NSLocalizedString(@"Recording: %lld frames, %lld dropped, "
+                                           "%ld waiting for encoder.",
+                                           @"Canvas Toolbar Tool Tip."),
+                         [videoRecorder frameNum],
+                         [videoRecorder droppedFrameNum],
+                         (long) [videoRecorder backlog]];
+    
+    for (NSToolbarItem *item in [[[self window] toolbar] items])
+        if ([[item itemIdentifier] isEqualToString:@"Video Capture"])
+            [item setToolTip:toolTip];
+}
+
+- (void)startVideoCapture:(NSString *)path
+{
+    DocumentController *documentController;
+    documentController = [NSDocumentController sharedDocumentController];
+    
+    videoRecorder = [[CanvasVideoRecorder alloc] initWithPath:path
+                                                      paAudio:[documentController paAudio]];
+    if (![videoRecorder open])
+    {
+        [videoRecorder release];
+        videoRecorder = nil;
+        
+        NSAlert *alert = [[NSAlert alloc] init];
+        [alert setMessageText:[NSString localizedStringWithFormat:
+                               @"The document \u201C%@\u201D could not be created.",
+                               [path lastPathComponent]]];
+        [alert setInformativeText:[NSString localizedStringWithFormat:
+                                   @"Try saving the document to another volume."]];
+        [alert runModal];
+        [alert release];
+        
+        return;
+    }
+    
+    [fCanvasView setVideoRecorder:videoRecorder];
+    
+    videoRecorderTimer = [[NSTimer scheduledTimerWithTimeInterval:1
+                                                           target:self
+                                                         selector:@selector(videoRecorderTimerDidExpire:)
+                                                         userInfo:nil
+                                                          repeats:YES] retain];
+}
+
+- (void)stopVideoCapture
+{
+    if (!videoRecorder)
+        return;
+    
+    [videoRecorderTimer invalidate];
+    [videoRecorderTimer release];
+    videoRecorderTimer = nil;
+    
+    [fCanvasView setVideoRecorder:nil];
+    
+    [videoRecorder close];
+    [videoRecorder release];
+    videoRecorder = nil;
+    
+    for (NSToolbarItem *item in [[[self window] toolbar] items])
+        if ([[item itemIdentifier] isEqualToString:@"Video Capture"])
+            [item setToolTip:NSLocalizedString(@"Start or stop recording video and audio.",
+                                               @"Canvas Toolbar Tool Tip.")];
+}
+
+- (IBAction)toggleVideoCapture:(id)sender
+{
+    if (videoRecorder)
+    {
+        [self stopVideoCapture];
+        
+        return;
+    }
+    
+    NSSavePanel *panel = [NSSavePanel savePanel];
+    [panel setAllowedFileTypes:[NSArray arrayWithObject:@"avi"]];
+    [panel setAllowsOtherFileTypes:NO];
+    
+    if ([panel runModal] == NSOKButton)
+        [self startVideoCapture:[[panel URL] path]];
+}
+
+// Remote display
+
+- (void)remoteDisplayTimerDidExpire:(NSTimer *)theTimer
+{
+    NSString *toolTip = [NSString localizedStringWithFormat:
+                         NSLocalizedString(@"Serving on port %d: %ld viewers, "
+                                           "%lld frames sent (%.1f MB).",
+                                           @"Canvas Toolbar Tool Tip."),
+                         [remoteDisplayServer port],
+                         (long) [remoteDisplayServer clientNum],
+                         [remoteDisplayServer sentFrameNum],
+                         [remoteDisplayServer sentByteNum] / 1048576.0];
+    
+    for (NSToolbarItem *item in [[[self window] toolbar] items])
+        if ([[item itemIdentifier] isEqualToString:@"Remote Display"])
+            [item setToolTip:toolTip];
+}
+
+- (void)startRemoteDisplay
+{
+    remoteDisplayServer = [[RemoteDisplayServer alloc] initWithDocument:[self document]
+                                                                 canvas:canvas
+                                                                   name:[self windowTitleForDocumentDisplayName:
+                                                                         [[self document] displayName]]];
+    if (![remoteDisplayServer open])
+    {
+        [remoteDisplayServer release];
+        remoteDisplayServer = nil;
+        
+        NSBeginAlertSheet(NSLocalizedString(@"The remote display can't be started.",
+                                            @"Canvas Alert"),
+                          nil, nil, nil,
+                          [self window],
+                          self, nil, nil, nil,
+                          [NSString localizedStringWithFormat:
+                           @"No free port was found from port %ld on.",
+                           (long) [[NSUserDefaults standardUserDefaults]
+                                   integerForKey:@"OERemoteDisplayPort"]]);
+        
+        return;
+    }
+    
+    [fCanvasView setRemoteDisplayServer:remoteDisplayServer];
+    
+    remoteDisplayTimer = [[NSTimer scheduledTimerWithTimeInterval:1
+                                                           target:self
+                                                         selector:@selector(remoteDisplayTimerDidExpire:)
+                                                         userInfo:nil
+                                                          repeats:YES] retain];
+    
+    [self remoteDisplayTimerDidExpire:remoteDisplayTimer];
+}
+
+- (void)stopRemoteDisplay
+{
+    if (!remoteDisplayServer)
+        return;
+    
+    [remoteDisplayTimer invalidate];
+    [remoteDisplayTimer release];
+    remoteDisplayTimer = nil;
+    
+    [fCanvasView setRemoteDisplayServer:nil];
+    
+    [remoteDisplayServer close];
+    [remoteDisplayServer release];
+    remoteDisplayServer = nil;
+    
+    for (NSToolbarItem *item in [[[self window] toolbar] items])
+        if ([[item itemIdentifier] isEqualToString:@"Remote Display"])
+            [item setToolTip:NSLocalizedString(@"Start or stop serving this display to RFB (VNC) viewers.",
+                                               @"Canvas Toolbar Tool Tip.")];
+}
+
+- (IBAction)toggleRemoteDisplay:(id)sender
+{
+    if (remoteDisplayServer)
+        [self stopRemoteDisplay];
+    else
+        [self startRemoteDisplay];
+}
+
 @end
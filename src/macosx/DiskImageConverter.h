@@ -0,0 +1,39 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Disk Image Converter
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Converts and verifies directories of disk images
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define DISKIMAGECONVERTER_TRACKNUM     35
+#define DISKIMAGECONVERTER_SECTORNUM    16
+#define DISKIMAGECONVERTER_SECTORSIZE   256
+#define DISKIMAGECONVERTER_IMAGESIZE    (DISKIMAGECONVERTER_TRACKNUM * \
+                                         DISKIMAGECONVERTER_SECTORNUM * \
+                                         DISKIMAGECONVERTER_SECTORSIZE)
+
+@interface DiskImageConverter : NSObject
+{
+    NSString *sourcePath;
+    NSString *destinationPath;
+    NSString *format;
+    
+    NSOperationQueue *queue;
+    NSMutableArray *results;
+}
+
+- (id)initWithSourcePath:(NSString *)theSourcePath
+         destinationPath:(NSString *)theDestinationPath
+                  format:(NSString *)theFormat;
+
+- (void)run;
+- (NSArray *)results;
+
++ (int)runWithArguments:(NSArray *)arguments;
+
+@end
@@ -0,0 +1,459 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Disk Image Converter
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Converts and verifies directories of disk images
+ */
+
+#import <CommonCrypto/CommonDigest.h>
+
+#import "DiskImageConverter.h"
+
+#define DISKIMAGECONVERTER_2IMG_SIGNATURE   "2IMG"
+#define DISKIMAGECONVERTER_2IMG_HEADERSIZE  64
+#define DISKIMAGECONVERTER_2IMG_DOSORDER    0
+#define DISKIMAGECONVERTER_2IMG_PRODOSORDER 1
+
+#define DISKIMAGECONVERTER_VTOC_TRACK       17
+#define DISKIMAGECONVERTER_CATALOG_ENTRYNUM 7
+#define DISKIMAGECONVERTER_CATALOG_MAXNUM   64
+#define DISKIMAGECONVERTER_VOLUME_BLOCK     2
+
+typedef enum
+{
+    DISKIMAGECONVERTER_UNKNOWN,
+    DISKIMAGECONVERTER_DOSORDER,
+    DISKIMAGECONVERTER_PRODOSORDER,
+    DISKIMAGECONVERTER_AMBIGUOUS,
+} DiskImageConverterOrder;
+
+// Maps ProDOS logical sectors to DOS 3.3 logical sectors and back
+static const int sectorMap[DISKIMAGECONVERTER_SECTORNUM] =
+{
+    0, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 15
+};
+
+static unsigned int getUInt32LE(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static DiskImageConverterOrder getOrder(NSString *extension)
+{
+    if ([extension isEqualToString:@"dsk"] ||
+        [extension isEqualToString:@"do"])
+        return DISKIMAGECONVERTER_DOSORDER;
+    else if ([extension isEqualToString:@"po"])
+        return DISKIMAGECONVERTER_PRODOSORDER;
+    
+    return DISKIMAGECONVERTER_UNKNOWN;
+}
+
+// The sector map is its own inverse
+static const unsigned char *getSector(const unsigned char *image,
+                                      int track, int dosSector,
+                                      DiskImageConverterOrder order)
+{
+    int sector = dosSector;
+    if (order == DISKIMAGECONVERTER_PRODOSORDER)
+        sector = sectorMap[dosSector];
+    
+    return image + (track * DISKIMAGECONVERTER_SECTORNUM + sector) * DISKIMAGECONVERTER_SECTORSIZE;
+}
+
+static const unsigned char *getBlock(const unsigned char *image,
+                                     int block,
+                                     DiskImageConverterOrder order)
+{
+    int track = block / 8;
+    int sector = (block % 8) * 2;
+    if (order == DISKIMAGECONVERTER_DOSORDER)
+        sector = sectorMap[sector];
+    
+    return image + (track * DISKIMAGECONVERTER_SECTORNUM + sector) * DISKIMAGECONVERTER_SECTORSIZE;
+}
+
+// Checks for a ProDOS volume directory key block
+static bool isVolumeDirectory(const unsigned char *p)
+{
+    return (!p[0] && !p[1] &&
+            ((p[4] & 0xf0) == 0xf0) &&
+            (p[4] & 0x0f) &&
+            (p[0x23] == 0x27) &&
+            (p[0x24] == 0x0d));
+}
+
+// Follows the DOS 3.3 catalog from the VTOC and counts the plausible file
+// entries, or returns -1 if there is no VTOC
+static int getCatalogEntryNum(const unsigned char *image, DiskImageConverterOrder order)
+{
+    const unsigned char *vtoc = getSector(image, DISKIMAGECONVERTER_VTOC_TRACK, 0, order);
+    if ((vtoc[0x27] != 122) ||
+        (vtoc[0x34] != DISKIMAGECONVERTER_TRACKNUM) ||
+        (vtoc[0x35] != DISKIMAGECONVERTER_SECTORNUM))
+        return -1;
+    
+    int entryNum = 0;
+    int track = vtoc[1];
+    int sector = vtoc[2];
+    
+    for (int i = 0; track && (i < DISKIMAGECONVERTER_CATALOG_MAXNUM); i++)
+    {
+        if ((track >= DISKIMAGECONVERTER_TRACKNUM) ||
+            (sector >= DISKIMAGECONVERTER_SECTORNUM))
+            break;
+        
+        const unsigned char *catalog = getSector(image, track, sector, order);
+        
+        for (int j = 0; j < DISKIMAGECONVERTER_CATALOG_ENTRYNUM; j++)
+        {
+            const unsigned char *entry = catalog + 0x0b + j * 35;
+            
+            // File names are stored with the high bit set
+            if (entry[0] && (entry[0] < DISKIMAGECONVERTER_TRACKNUM) &&
+                (entry[1] < DISKIMAGECONVERTER_SECTORNUM) &&
+                (entry[3] & 0x80))
+                entryNum++;
+        }
+        
+        track = catalog[1];
+        sector = catalog[2];
+    }
+    
+    return entryNum;
+}
+
+// Reads the sector order from the file system. Both orders place the VTOC
+// and the first catalog sector at the same offsets, so a DOS 3.3 catalog
+// is only conclusive when following it in one order finds more files.
+static DiskImageConverterOrder detectOrder(NSData *data)
+{
+    if ([data length] != DISKIMAGECONVERTER_IMAGESIZE)
+        return DISKIMAGECONVERTER_UNKNOWN;
+    
+    const unsigned char *image = [data bytes];
+    
+    bool isDOSOrder = isVolumeDirectory(getBlock(image, DISKIMAGECONVERTER_VOLUME_BLOCK,
+                                                 DISKIMAGECONVERTER_DOSORDER));
+    bool isProDOSOrder = isVolumeDirectory(getBlock(image, DISKIMAGECONVERTER_VOLUME_BLOCK,
+                                                    DISKIMAGECONVERTER_PRODOSORDER));
+    
+    int dosEntryNum = getCatalogEntryNum(image, DISKIMAGECONVERTER_DOSORDER);
+    int prodosEntryNum = getCatalogEntryNum(image, DISKIMAGECONVERTER_PRODOSORDER);
+    
+    if (dosEntryNum > prodosEntryNum)
+        isDOSOrder = true;
+    else if (prodosEntryNum > dosEntryNum)
+        isProDOSOrder = true;
+    else if ((dosEntryNum >= 0) && !isDOSOrder && !isProDOSOrder)
+        return DISKIMAGECONVERTER_AMBIGUOUS;
+    
+    if (isDOSOrder && isProDOSOrder)
+        return DISKIMAGECONVERTER_AMBIGUOUS;
+    else if (isDOSOrder)
+        return DISKIMAGECONVERTER_DOSORDER;
+    else if (isProDOSOrder)
+        return DISKIMAGECONVERTER_PRODOSORDER;
+    
+    return DISKIMAGECONVERTER_UNKNOWN;
+}
+
+static NSString *getSHA1(NSData *data)
+{
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1([data bytes], (CC_LONG) [data length], digest);
+    
+    NSMutableString *hash = [NSMutableString string];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++)
+        [hash appendFormat:@"%02x", digest[i]];
+    
+    return hash;
+}
+
+@implementation DiskImageConverter
+
+- (id)initWithSourcePath:(NSString *)theSourcePath
+         destinationPath:(NSString *)theDestinationPath
+                  format:(NSString *)theFormat
+{
+    self = [super init];
+    
+    if (self)
+    {
+        sourcePath = [theSourcePath copy];
+        destinationPath = [theDestinationPath copy];
+        format = [[theFormat lowercaseString] copy];
+        
+        queue = [[NSOperationQueue alloc] init];
+        results = [[NSMutableArray alloc] init];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [sourcePath release];
+    [destinationPath release];
+    [format release];
+    
+    [queue release];
+    [results release];
+    
+    [super dealloc];
+}
+
+- (void)addResult:(NSString *)path
+           status:(NSString *)status
+             size:(NSUInteger)size
+             time:(double)time
+             hash:(NSString *)hash
+{
+    NSDictionary *result = [NSDictionary dictionaryWithObjectsAndKeys:
+                            path, @"path",
+                            status, @"status",
+                            [NSNumber numberWithUnsignedInteger:size], @"size",
+                            [NSNumber numberWithDouble:time], @"time",
+                            (hash ? hash : @""), @"hash",
+                            nil];
+    
+    @synchronized(results)
+    {
+        [results addObject:result];
+    }
+}
+
+- (NSData *)readImage:(NSString *)path order:(DiskImageConverterOrder *)order
+{
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    if (!data)
+        return nil;
+    
+    NSString *extension = [[path pathExtension] lowercaseString];
+    
+    // Unwrap 2IMG containers
+    if ([extension isEqualToString:@"2mg"] ||
+        [extension isEqualToString:@"2img"])
+    {
+        const unsigned char *p = [data bytes];
+        
+        if (([data length] < DISKIMAGECONVERTER_2IMG_HEADERSIZE) ||
+            memcmp(p, DISKIMAGECONVERTER_2IMG_SIGNATURE, 4))
+            return nil;
+        
+        unsigned int imageFormat = getUInt32LE(p + 12);
+        unsigned int dataOffset = getUInt32LE(p + 24);
+        unsigned int dataLength = getUInt32LE(p + 28);
+        
+        if (imageFormat == DISKIMAGECONVERTER_2IMG_DOSORDER)
+            *order = DISKIMAGECONVERTER_DOSORDER;
+        else if (imageFormat == DISKIMAGECONVERTER_2IMG_PRODOSORDER)
+            *order = DISKIMAGECONVERTER_PRODOSORDER;
+        else
+            return nil;
+        
+        if ((unsigned long long) dataOffset + dataLength > [data length])
+            return nil;
+        
+        return [data subdataWithRange:NSMakeRange(dataOffset, dataLength)];
+    }
+    
+    *order = getOrder(extension);
+    
+    return data;
+}
+
+- (void)convertImage:(NSString *)subpath
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
+    NSString *path = [sourcePath stringByAppendingPathComponent:subpath];
+    NSString *outputPath = [[destinationPath stringByAppendingPathComponent:
+                             [subpath stringByDeletingPathExtension]]
+                            stringByAppendingPathExtension:format];
+    
+    DiskImageConverterOrder order = DISKIMAGECONVERTER_UNKNOWN;
+    NSData *data = [self readImage:path order:&order];
+    DiskImageConverterOrder outputOrder = getOrder(format);
+    
+    // A .dsk may be in either order; the file system decides. Images
+    // without a recognizable file system keep the order they claim, and
+    // a .dsk converted that way is flagged.
+    DiskImageConverterOrder detectedOrder = detectOrder(data);
+    BOOL isDetected = ((detectedOrder == DISKIMAGECONVERTER_DOSORDER) ||
+                       (detectedOrder == DISKIMAGECONVERTER_PRODOSORDER));
+    BOOL isGeneric = [[[path pathExtension] lowercaseString] isEqualToString:@"dsk"];
+    
+    if (!data || (order == DISKIMAGECONVERTER_UNKNOWN))
+        [self addResult:subpath status:@"unreadable" size:0 time:0 hash:nil];
+    else if ((order != outputOrder) &&
+             ([data length] != DISKIMAGECONVERTER_IMAGESIZE))
+        [self addResult:subpath status:@"unsupported size" size:[data length] time:0 hash:nil];
+    else if (isGeneric && (detectedOrder == DISKIMAGECONVERTER_AMBIGUOUS))
+        [self addResult:subpath status:@"ambiguous order" size:[data length] time:0 hash:nil];
+    else if (isDetected && (detectedOrder != order) && !isGeneric)
+        [self addResult:subpath status:@"order mismatch" size:[data length] time:0 hash:nil];
+    else
+    {
+        if (isDetected)
+            order = detectedOrder;
+        
+        NSMutableData *outputData = [NSMutableData dataWithData:data];
+        
+        if (order != outputOrder)
+        {
+            const unsigned char *src = [data bytes];
+            unsigned char *dest = [outputData mutableBytes];
+            
+            for (int track = 0; track < DISKIMAGECONVERTER_TRACKNUM; track++)
+            {
+                int trackOffset = track * DISKIMAGECONVERTER_SECTORNUM * DISKIMAGECONVERTER_SECTORSIZE;
+                
+                for (int sector = 0; sector < DISKIMAGECONVERTER_SECTORNUM; sector++)
+                    memcpy(dest + trackOffset + sector * DISKIMAGECONVERTER_SECTORSIZE,
+                           src + trackOffset + sectorMap[sector] * DISKIMAGECONVERTER_SECTORSIZE,
+                           DISKIMAGECONVERTER_SECTORSIZE);
+            }
+        }
+        
+        [[NSFileManager defaultManager] createDirectoryAtPath:[outputPath stringByDeletingLastPathComponent]
+                                  withIntermediateDirectories:YES
+                                                   attributes:nil
+                                                        error:nil];
+        
+        NSString *hash = getSHA1(outputData);
+        
+        // Verify by reading back what was written, and by finding the file
+        // system again in the output order
+        NSString *status;
+        if (![outputData writeToFile:outputPath atomically:YES])
+            status = @"write failed";
+        else if (![getSHA1([NSData dataWithContentsOfFile:outputPath]) isEqualToString:hash])
+            status = @"verify failed";
+        else if (isDetected && (detectOrder(outputData) != outputOrder))
+            status = @"verify failed";
+        else if (!isDetected && isGeneric && (order != outputOrder))
+            status = @"ok, dos order assumed";
+        else
+            status = @"ok";
+        
+        [self addResult:subpath
+                 status:status
+                   size:[data length]
+                   time:CFAbsoluteTimeGetCurrent() - startTime
+                   hash:hash];
+    }
+    
+    [pool drain];
+}
+
+- (void)run
+{
+    NSArray *extensions = [NSArray arrayWithObjects:
+                           @"dsk", @"do", @"po", @"2mg", @"2img",
+                           nil];
+    
+    NSMutableArray *subpaths = [NSMutableArray array];
+    
+    BOOL isDirectory;
+    if (![[NSFileManager defaultManager] fileExistsAtPath:sourcePath
+                                              isDirectory:&isDirectory])
+        return;
+    
+    if (isDirectory)
+    {
+        NSDirectoryEnumerator *enumerator;
+        enumerator = [[NSFileManager defaultManager] enumeratorAtPath:sourcePath];
+        
+        NSString *subpath;
+        while ((subpath = [enumerator nextObject]))
+        {
+            if ([extensions containsObject:[[subpath pathExtension] lowercaseString]])
+                [subpaths addObject:subpath];
+        }
+    }
+    else
+    {
+        [subpaths addObject:[sourcePath lastPathComponent]];
+        
+        NSString *theSourcePath = [sourcePath stringByDeletingLastPathComponent];
+        [sourcePath release];
+        sourcePath = [theSourcePath copy];
+    }
+    
+    for (NSString *subpath in subpaths)
+    {
+        NSInvocationOperation *operation;
+        operation = [[NSInvocationOperation alloc] initWithTarget:self
+                                                         selector:@selector(convertImage:)
+                                                           object:subpath];
+        [queue addOperation:operation];
+        [operation release];
+    }
+    
+    [queue waitUntilAllOperationsAreFinished];
+}
+
+- (NSArray *)results
+{
+    return results;
+}
+
++ (int)runWithArguments:(NSArray *)arguments
+{
+    if (([arguments count] != 3) ||
+        (getOrder([arguments objectAtIndex:2]) == DISKIMAGECONVERTER_UNKNOWN))
+    {
+        fprintf(stderr, "usage: OpenEmulator --convert-disk-images source destination dsk|do|po\n");
+        
+        return 1;
+    }
+    
+    DiskImageConverter *converter;
+    converter = [[[DiskImageConverter alloc] initWithSourcePath:[arguments objectAtIndex:0]
+                                                destinationPath:[arguments objectAtIndex:1]
+                                                         format:[arguments objectAtIndex:2]]
+                 autorelease];
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
+    [converter run];
+    
+    double totalTime = CFAbsoluteTimeGetCurrent() - startTime;
+    unsigned long long totalSize = 0;
+    int failedNum = 0;
+    
+    for (NSDictionary *result in [converter results])
+    {
+        NSString *status = [result objectForKey:@"status"];
+        double time = [[result objectForKey:@"time"] doubleValue];
+        unsigned long long size = [[result objectForKey:@"size"] unsignedLongLongValue];
+        
+        if ([status hasPrefix:@"ok"])
+            totalSize += size;
+        else
+            failedNum++;
+        
+        printf("%s\t%s\t%s\t%.1f MB/s\n",
+               [[result objectForKey:@"path"] UTF8String],
+               [status UTF8String],
+               [[result objectForKey:@"hash"] UTF8String],
+               (time > 0) ? size / time / 1048576.0 : 0.0);
+    }
+    
+    printf("%lu images, %d failed, %.1f MB in %.3f s (%.1f MB/s)\n",
+           (unsigned long) [[converter results] count],
+           failedNum,
+           totalSize / 1048576.0,
+           totalTime,
+           (totalTime > 0) ? totalSize / totalTime / 1048576.0 : 0.0);
+    
+    return failedNum ? 1 : 0;
+}
+
+@end
@@ -11,28 +11,57 @@
 #import <Cocoa/Cocoa.h>
 
 #define USER_TEMPLATES_FOLDER @"~/Library/Application Support/OpenEmulator/Templates"
+#define FORKS_FOLDER @"OpenEmulator Forks"
 
 @class EmulationWindowController;
 
 @interface Document : NSDocument
 {
     void *emulation;
+    void *inputRecorder;
+    void *textScreen;
     
     EmulationWindowController *emulationWindowController;
     NSMutableArray *canvasWindowControllers;
     
     BOOL newCanvasesCapture;
     NSMutableArray *newCanvases;
+    
+    NSOperationQueue *mountQueue;
+    
+    NSString *forkPath;
+    NSString *emulationPath;
+    NSString *inputReplayPath;
 }
 
 - (id)initWithTemplateURL:(NSURL *)templateURL error:(NSError **)outError;
+- (id)initWithTemplateURL:(NSURL *)templateURL
+              inputReplay:(NSString *)path
+                    error:(NSError **)outError;
 - (IBAction)saveDocumentAsTemplate:(id)sender;
+- (IBAction)forkDocument:(id)sender;
+- (NSArray *)forkEmulation:(NSInteger)count error:(NSError **)outError;
+- (void)setForkPath:(NSString *)thePath;
 
 - (void *)constructEmulation:(NSURL *)url;
 - (void)destroyEmulation;
 - (void)lockEmulation;
 - (void)unlockEmulation;
 - (void *)emulation;
+- (NSString *)emulationPath;
+- (void *)inputRecorder;
+- (void *)textScreen;
+
+- (IBAction)toggleInputRecording:(id)sender;
+- (IBAction)toggleInputReplay:(id)sender;
+- (BOOL)isInputRecording;
+- (BOOL)isInputReplaying;
+
+- (NSArray *)textScreenRows;
+- (long long)textScreenSequence;
+- (BOOL)waitForTextScreen:(NSString *)text
+                      row:(NSInteger)row
+                  timeout:(NSTimeInterval)timeout;
 
 - (IBAction)showEmulation:(id)sender;
 - (void)constructCanvas:(NSDictionary *)dict;
@@ -40,10 +69,15 @@
 - (void)showCanvas:(NSValue *)canvasValue;
 - (void)captureNewCanvases:(BOOL)value;
 - (void)showNewCanvases;
+- (NSArray *)canvasWindowControllers;
 
 - (BOOL)canMountNow:(NSString *)path;
 - (BOOL)mount:(NSString *)path;
 - (BOOL)canMount:(NSString *)path;
+- (void)prepareMount:(NSString *)path
+             context:(id)theContext
+              target:(id)theTarget
+              action:(SEL)theAction;
 
 - (void)sendPowerDown:(id)sender;
 - (void)sendSleep:(id)sender;
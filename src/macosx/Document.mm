@@ -10,11 +10,15 @@
 
 #import <sstream>
 
+#import <copyfile.h>
+#import <sys/stat.h>
+
 #import "Document.h"
 
 #import "NSStringAdditions.h"
 
 #import "DocumentController.h"
+#import "DocumentInfoCache.h"
 
 #import "EmulationWindowController.h"
 #import "CanvasWindowController.h"
@@ -22,6 +26,12 @@
 #import "CanvasWindow.h"
 #import "CanvasPrintView.h"
 
+#import "InputRecorder.h"
+#import "TextScreen.h"
+#import "PackageBlobStore.h"
+#import "MountOperation.h"
+#import "MountProgressController.h"
+
 #import "OEEmulation.h"
 #import "PAAudio.h"
 #import "OpenGLCanvas.h"
@@ -29,6 +39,9 @@
 #import "DeviceInterface.h"
 #import "StorageInterface.h"
 
+// Larger files, such as hard disk images, are left to be paged in on demand
+#define DOCUMENT_PREFETCH_MAXSIZE   (4 * 1048576)
+
 @implementation Document
 
 // Callbacks
@@ -56,6 +69,15 @@ OEComponent *constructCanvas(void *userData, OEComponent *device, OECanvasType c
     device->postMessage(NULL, DEVICE_GET_LABEL, &label);
     
     Document *document = (Document *)userData;
+    
+    InputRecorder *inputRecorder = (InputRecorder *)[document inputRecorder];
+    if (inputRecorder)
+        inputRecorder->addCanvas(canvas);
+    
+    TextScreen *textScreen = (TextScreen *)[document textScreen];
+    if (textScreen && !textScreen->getCanvas() && (canvasType == OECANVAS_DISPLAY))
+        textScreen->setCanvas(canvas);
+    
     NSDictionary *dict = [NSDictionary dictionaryWithObjectsAndKeys:
                           [NSValue valueWithPointer:device], @"device",
                           [NSString stringWithCPPString:label], @"label",
@@ -81,6 +103,14 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     Document *document = (Document *)userData;
     NSValue *canvasValue = [NSValue valueWithPointer:canvas];
     
+    InputRecorder *inputRecorder = (InputRecorder *)[document inputRecorder];
+    if (inputRecorder)
+        inputRecorder->removeCanvas(canvas);
+    
+    TextScreen *textScreen = (TextScreen *)[document textScreen];
+    if (textScreen && (textScreen->getCanvas() == canvas))
+        textScreen->setCanvas(NULL);
+    
     if ([NSThread isMainThread])
         [document destroyCanvas:canvasValue];
     else
@@ -95,9 +125,22 @@ void destroyCanvas(void *userData, OEComponent *canvas)
 
 - (id)initWithTemplateURL:(NSURL *)absoluteURL
                     error:(NSError **)outError
+{
+    return [self initWithTemplateURL:absoluteURL
+                         inputReplay:nil
+                               error:outError];
+}
+
+// Replays are loaded before the emulation opens, so no step runs unarmed
+- (id)initWithTemplateURL:(NSURL *)absoluteURL
+              inputReplay:(NSString *)path
+                    error:(NSError **)outError
 {
     self = [super init];
     
+    if (self)
+        inputReplayPath = [path copy];
+    
     if (self && [self readFromURL:absoluteURL
                            ofType:nil
                             error:outError])
@@ -120,6 +163,12 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     
     [newCanvases release];
     
+    [mountQueue release];
+    
+    [forkPath release];
+    
+    [inputReplayPath release];
+    
     [super dealloc];
 }
 
@@ -211,6 +260,11 @@ void destroyCanvas(void *userData, OEComponent *canvas)
                   forSaveOperation:saveOperation
                              error:outError];
     
+    // Only copies are shared: the package the emulation runs from keeps its
+    // files, as mounted storages may still write to them
+    if (result && (saveOperation == NSSaveToOperation))
+        [[PackageBlobStore sharedStore] deduplicatePackage:[absoluteURL path]];
+    
     OEEmulation *theEmulation = (OEEmulation *)emulation;
     if (theEmulation->isActive())
         [self updateChangeCount:NSChangeDone];
@@ -252,15 +306,175 @@ void destroyCanvas(void *userData, OEComponent *canvas)
                    ofType:nil
                     error:&error])
         [[NSAlert alertWithError:error] runModal];
+    else
+        [[PackageBlobStore sharedStore] deduplicatePackage:[[panel URL] path]];
+}
+
+- (IBAction)forkDocument:(id)sender
+{
+    NSError *error;
+    if (![self forkEmulation:1 error:&error])
+        [[NSAlert alertWithError:error] runModal];
+}
+
+- (NSArray *)forkEmulation:(NSInteger)count error:(NSError **)outError
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    
+    NSString *forksPath = [[NSTemporaryDirectory() stringByAppendingPathComponent:FORKS_FOLDER]
+                           stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    if (![fileManager createDirectoryAtPath:forksPath
+                withIntermediateDirectories:YES
+                                 attributes:nil
+                                      error:outError])
+        return nil;
+    
+    // Save the running machine once
+    NSString *snapshotPath = [forksPath stringByAppendingPathComponent:@"Snapshot.emulation"];
+    if (![self writeToURL:[NSURL fileURLWithPath:snapshotPath]
+                   ofType:nil
+                    error:outError])
+    {
+        [fileManager removeItemAtPath:forksPath error:nil];
+        
+        return nil;
+    }
+    
+    // Clone the snapshot, so disk images are shared copy-on-write on disk
+    NSMutableArray *paths = [NSMutableArray array];
+    for (NSInteger i = 0; i < count; i++)
+    {
+        NSString *path = [forksPath stringByAppendingPathComponent:
+                          [NSString stringWithFormat:@"Fork %ld.emulation", (long) (i + 1)]];
+
+        // COPYFILE_CLONE is only understood from Mac OS X 10.12, like
+        // clonefile(); it falls back to copying the data when cloning fails
+        copyfile_flags_t flags = COPYFILE_ALL | COPYFILE_RECURSIVE;
+#ifdef COPYFILE_CLONE
+        if ([PackageBlobStore isCloneAvailable])
+            flags |= COPYFILE_CLONE;
+#endif
+        if (copyfile([snapshotPath fileSystemRepresentation],
+                     [path fileSystemRepresentation],
+                     NULL,
+                     flags) != 0)
+        {
+            if (outError)
+                *outError = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                code:errno
+                                            userInfo:nil];
+            
+            [fileManager removeItemAtPath:forksPath error:nil];
+            
+            return nil;
+        }
+        
+        [paths addObject:path];
+    }
+    
+    [fileManager removeItemAtPath:snapshotPath error:nil];
+    
+    // Forks open as untitled documents, like new documents from templates
+    DocumentController *documentController;
+    documentController = [NSDocumentController sharedDocumentController];
+    
+    NSMutableArray *documents = [NSMutableArray array];
+    for (NSString *path in paths)
+    {
+        Document *document;
+        document = [documentController openUntitledDocumentWithTemplateURL:[NSURL fileURLWithPath:path]
+                                                                   display:YES
+                                                                     error:outError];
+        if (!document)
+        {
+            // Forks already open keep their copies
+            NSRange range = NSMakeRange([documents count], [paths count] - [documents count]);
+            for (NSString *unopenedPath in [paths subarrayWithRange:range])
+                [fileManager removeItemAtPath:unopenedPath error:nil];
+            rmdir([forksPath fileSystemRepresentation]);
+            
+            return nil;
+        }
+        
+        // The fork owns its copy, which is removed when it closes
+        [document setForkPath:path];
+        [document setDisplayName:[NSString stringWithFormat:@"%@ (%@)",
+                                  [self displayName],
+                                  [[path lastPathComponent] stringByDeletingPathExtension]]];
+        
+        [documents addObject:document];
+    }
+    
+    return documents;
 }
 
 - (void)close
 {
+    [self logRenderStatistics];
+    
+    [mountQueue cancelAllOperations];
+    [mountQueue waitUntilAllOperationsAreFinished];
+    
     [self destroyEmulation];
     
+    // Remove the fork copy, and its folder once the last fork is closed
+    if (forkPath)
+    {
+        [[NSFileManager defaultManager] removeItemAtPath:forkPath error:nil];
+        rmdir([[forkPath stringByDeletingLastPathComponent] fileSystemRepresentation]);
+        
+        [forkPath release];
+        forkPath = nil;
+    }
+    
     [super close];
 }
 
+- (void)setForkPath:(NSString *)thePath
+{
+    [forkPath release];
+    forkPath = [thePath copy];
+}
+
+// Only logged with the OEDebugRenderStatistics default set
+- (void)logRenderStatistics
+{
+    if (![[NSUserDefaults standardUserDefaults] boolForKey:@"OEDebugRenderStatistics"])
+        return;
+    
+    long long skippedFrameNum = 0;
+    double savedRenderTime = 0;
+    NSInteger openedCanvasNum = 0;
+    double openTime = 0;
+    double openMaxTime = 0;
+    
+    for (CanvasWindowController *canvasWindowController in canvasWindowControllers)
+    {
+        CanvasView *canvasView = [canvasWindowController canvasView];
+        
+        skippedFrameNum += [canvasView skippedFrameNum];
+        savedRenderTime += [canvasView savedRenderTime];
+        
+        // Canvas views that were never shown did not open their canvas
+        if ([canvasView openTime])
+        {
+            openedCanvasNum++;
+            openTime += [canvasView openTime];
+            if ([canvasView openTime] > openMaxTime)
+                openMaxTime = [canvasView openTime];
+        }
+    }
+    
+    if (openedCanvasNum)
+        NSLog(@"%@: opened %ld canvases in %.1f ms on average, %.1f ms at most",
+              [self displayName], (long) openedCanvasNum,
+              openTime / openedCanvasNum * 1000, openMaxTime * 1000);
+    
+    if (skippedFrameNum)
+        NSLog(@"%@: skipped %lld background frames, saving %.2f s of render time",
+              [self displayName], skippedFrameNum, savedRenderTime);
+}
+
 // Emulation
 
 - (void)didUpdate:(id)sender
@@ -271,6 +485,62 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     [emulationWindowController updateWindow:self];
 }
 
+- (NSArray *)resourcePathsForURL:(NSURL *)url
+{
+    NSMutableArray *paths = [NSMutableArray array];
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    
+    NSString *packagePath = [url path];
+    NSString *resourcePath = [[[NSUserDefaults standardUserDefaults] URLForKey:@"OEDefaultResourcesPath"] path];
+    
+    // Package contents, such as disk images
+    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:packagePath];
+    NSString *subpath;
+    while ((subpath = [enumerator nextObject]))
+    {
+        if ([[[enumerator fileAttributes] fileType] isEqualToString:NSFileTypeRegular])
+            [paths addObject:[packagePath stringByAppendingPathComponent:subpath]];
+    }
+    
+    // Resources referenced by the description, as found by the info cache
+    NSDictionary *info = [[DocumentInfoCache sharedCache] infoForPath:packagePath];
+    for (NSString *value in [info objectForKey:@"resources"])
+    {
+        NSString *path = [resourcePath stringByAppendingPathComponent:value];
+        BOOL isDirectory;
+        if ([fileManager fileExistsAtPath:path isDirectory:&isDirectory] && !isDirectory)
+            [paths addObject:path];
+    }
+    
+    return paths;
+}
+
+- (void)prefetchResources:(NSArray *)paths
+{
+    // Asks the kernel to read the small files ahead, without waiting,
+    // so open() is more likely to find their data in the page cache
+    for (NSString *path in paths)
+    {
+        int fd = open([path fileSystemRepresentation], O_RDONLY);
+        if (fd < 0)
+            continue;
+        
+        struct stat st;
+        if (!fstat(fd, &st) &&
+            (st.st_size > 0) &&
+            (st.st_size <= DOCUMENT_PREFETCH_MAXSIZE))
+        {
+            struct radvisory advisory;
+            advisory.ra_offset = 0;
+            advisory.ra_count = (int) st.st_size;
+            
+            fcntl(fd, F_RDADVISE, &advisory);
+        }
+        
+        close(fd);
+    }
+}
+
 - (void *)constructEmulation:(NSURL *)url
 {
     if (!canvasWindowControllers)
@@ -283,6 +553,24 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     
     OEEmulation *theEmulation = new OEEmulation();
     
+    InputRecorder *theInputRecorder = new InputRecorder();
+    theInputRecorder->setEmulation(theEmulation);
+    inputRecorder = theInputRecorder;
+    
+    if (inputReplayPath &&
+        !theInputRecorder->loadReplay([inputReplayPath cppString]))
+    {
+        delete theEmulation;
+        
+        delete theInputRecorder;
+        inputRecorder = NULL;
+        
+        return NULL;
+    }
+    
+    TextScreen *theTextScreen = new TextScreen();
+    textScreen = theTextScreen;
+    
     theEmulation->setResourcePath([[[NSUserDefaults standardUserDefaults] URLForKey:@"OEDefaultResourcesPath"].path cppString]);
     theEmulation->setConstructCanvas(constructCanvas);
     theEmulation->setDestroyCanvas(destroyCanvas);
@@ -292,14 +580,32 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     theEmulation->addComponent("audio", paAudio);
     theEmulation->addComponent("joystick", hidJoystick);
     
+    [self prefetchResources:[self resourcePathsForURL:url]];
+    
     [self lockEmulation];
     
     if (theEmulation->open([[url path] cppString]))
+    {
         theEmulation->setDidUpdate(didUpdate);
+        
+        [emulationPath release];
+        emulationPath = [[url path] copy];
+        
+        // Arms a loaded replay before the emulation is unlocked
+        theInputRecorder->markOpen();
+        theInputRecorder->setAudio(paAudio);
+        theTextScreen->setAudio(paAudio);
+    }
     else
     {
         delete theEmulation;
         theEmulation = nil;
+        
+        delete theInputRecorder;
+        inputRecorder = NULL;
+        
+        delete theTextScreen;
+        textScreen = NULL;
     }
     
     [self unlockEmulation];
@@ -319,7 +625,16 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     
     delete theEmulation;
     
+    delete (InputRecorder *)inputRecorder;
+    inputRecorder = NULL;
+    
+    delete (TextScreen *)textScreen;
+    textScreen = NULL;
+    
     [self unlockEmulation];
+    
+    [emulationPath release];
+    emulationPath = nil;
 }
 
 - (void)lockEmulation
@@ -343,6 +658,261 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     return emulation;
 }
 
+// The package or description the emulation was opened from, which may
+// differ from the file URL for templates and forks
+- (NSString *)emulationPath
+{
+    return emulationPath;
+}
+
+- (void *)inputRecorder
+{
+    return inputRecorder;
+}
+
+- (void *)textScreen
+{
+    return textScreen;
+}
+
+// Input recording
+
+- (IBAction)toggleInputRecording:(id)sender
+{
+    if ([self isInputRecording])
+    {
+        [self lockEmulation];
+        
+        ((InputRecorder *)inputRecorder)->stopRecording();
+        
+        [self unlockEmulation];
+        
+        return;
+    }
+    
+    NSSavePanel *panel = [NSSavePanel savePanel];
+    [panel setAllowedFileTypes:[NSArray arrayWithObject:@"oeinput"]];
+    [panel beginSheetForDirectory:nil
+                             file:nil
+                   modalForWindow:[self windowForSheet]
+                    modalDelegate:self
+                   didEndSelector:@selector(startInputRecordingDidEnd:
+                                            returnCode:contextInfo:)
+                      contextInfo:nil];
+}
+
+- (void)startInputRecordingDidEnd:(NSSavePanel *)panel
+                       returnCode:(int)returnCode
+                      contextInfo:(void *)contextInfo
+{
+    if ((returnCode != NSOKButton) || !inputRecorder)
+        return;
+    
+    NSString *path = [[panel URL] path];
+    NSString *snapshotPath = [path stringByAppendingPathExtension:@"emulation"];
+    [[NSFileManager defaultManager] removeItemAtPath:snapshotPath error:nil];
+    
+    // The snapshot is taken in the same step as the recording starts, so
+    // a replay begins from exactly the recorded state
+    [self lockEmulation];
+    
+    bool success = (((OEEmulation *)emulation)->save([[snapshotPath stringByAppendingString:@"/"]
+                                                      cppString]) &&
+                    ((InputRecorder *)inputRecorder)->startRecording([path cppString]));
+    
+    [self unlockEmulation];
+    
+    if (!success)
+    {
+        NSString *messageText = NSLocalizedString(@"The input recording could not be started.",
+                                                  @"Document.");
+        NSString *informativeText = NSLocalizedString(@"Try saving the recording to another volume.",
+                                                      @"Document.");
+        NSAlert *alert = [NSAlert alertWithMessageText:messageText
+                                         defaultButton:nil
+                                       alternateButton:nil
+                                           otherButton:nil
+                             informativeTextWithFormat:informativeText];
+        [alert runModal];
+    }
+}
+
+- (IBAction)toggleInputReplay:(id)sender
+{
+    if ([self isInputReplaying])
+    {
+        [self lockEmulation];
+        
+        ((InputRecorder *)inputRecorder)->stopReplay();
+        
+        [self unlockEmulation];
+        
+        return;
+    }
+    
+    NSOpenPanel *panel = [NSOpenPanel openPanel];
+    [panel beginSheetForDirectory:nil
+                             file:nil
+                            types:[NSArray arrayWithObject:@"oeinput"]
+                   modalForWindow:[self windowForSheet]
+                    modalDelegate:self
+                   didEndSelector:@selector(startInputReplayDidEnd:
+                                            returnCode:contextInfo:)
+                      contextInfo:nil];
+}
+
+- (void)startInputReplayDidEnd:(NSOpenPanel *)panel
+                    returnCode:(int)returnCode
+                   contextInfo:(void *)contextInfo
+{
+    if (returnCode != NSOKButton)
+        return;
+    
+    [panel orderOut:self];
+    
+    NSString *path = [[panel URL] path];
+    NSString *snapshotPath = [path stringByAppendingPathExtension:@"emulation"];
+    
+    NSString *messageText = NSLocalizedString(@"The input recording could not be replayed.",
+                                              @"Document.");
+    NSString *informativeText = nil;
+    
+    // Replays run on a new document opened from the recorded snapshot
+    Document *document = nil;
+    if (![[NSFileManager defaultManager] fileExistsAtPath:snapshotPath])
+        informativeText = NSLocalizedString(@"The snapshot saved with the recording is missing.",
+                                            @"Document.");
+    else
+    {
+        DocumentController *documentController;
+        documentController = [NSDocumentController sharedDocumentController];
+        
+        document = [documentController openUntitledDocumentWithTemplateURL:[NSURL fileURLWithPath:snapshotPath]
+                                                               inputReplay:path
+                                                                   display:YES
+                                                                     error:nil];
+        
+        if (!document)
+            informativeText = NSLocalizedString(@"The file is damaged, or the snapshot saved with it could not be opened.",
+                                                @"Document.");
+        else
+            [document setDisplayName:[NSString stringWithFormat:@"%@ (%@)",
+                                      [self displayName],
+                                      NSLocalizedString(@"Replay", @"Document.")]];
+    }
+    
+    if (informativeText)
+    {
+        NSAlert *alert = [NSAlert alertWithMessageText:messageText
+                                         defaultButton:nil
+                                       alternateButton:nil
+                                           otherButton:nil
+                             informativeTextWithFormat:informativeText];
+        [alert runModal];
+    }
+}
+
+- (BOOL)isInputRecording
+{
+    if (!inputRecorder)
+        return NO;
+    
+    [self lockEmulation];
+    
+    BOOL value = ((InputRecorder *)inputRecorder)->isRecording();
+    
+    [self unlockEmulation];
+    
+    return value;
+}
+
+- (BOOL)isInputReplaying
+{
+    if (!inputRecorder)
+        return NO;
+    
+    [self lockEmulation];
+    
+    BOOL value = ((InputRecorder *)inputRecorder)->isReplaying();
+    
+    [self unlockEmulation];
+    
+    return value;
+}
+
+// Text screen
+
+- (NSArray *)textScreenRows
+{
+    [self lockEmulation];
+    
+    if (!textScreen)
+    {
+        [self unlockEmulation];
+        
+        return nil;
+    }
+    
+    ((TextScreen *)textScreen)->update();
+    
+    TextScreenRows rows = ((TextScreen *)textScreen)->getRows();
+    
+    [self unlockEmulation];
+    
+    NSMutableArray *result = [NSMutableArray array];
+    for (TextScreenRows::iterator i = rows.begin();
+         i != rows.end();
+         i++)
+        [result addObject:[NSString stringWithCPPWString:*i]];
+    
+    return result;
+}
+
+- (long long)textScreenSequence
+{
+    // The sequence counts changes seen when the rows are refreshed
+    long long sequence = 0;
+    
+    [self lockEmulation];
+    
+    if (textScreen)
+    {
+        ((TextScreen *)textScreen)->update();
+        
+        sequence = ((TextScreen *)textScreen)->getSequence();
+    }
+    
+    [self unlockEmulation];
+    
+    return sequence;
+}
+
+- (BOOL)waitForTextScreen:(NSString *)text
+                      row:(NSInteger)row
+                  timeout:(NSTimeInterval)timeout
+{
+    [self lockEmulation];
+    
+    TextScreen *theTextScreen = (TextScreen *)textScreen;
+    TextScreenWait *wait = NULL;
+    if (theTextScreen)
+    {
+        theTextScreen->update();
+        
+        wait = theTextScreen->addWait([text cppWString],
+                                      (row < 0) ? TEXTSCREEN_ANYROW : (int) row);
+    }
+    
+    [self unlockEmulation];
+    
+    if (!wait)
+        return NO;
+    
+    // The emulation must keep running while we wait. Closing the document
+    // fails the wait before the screen is deleted.
+    return theTextScreen->waitForText(wait, (float) timeout);
+}
+
 // Window controllers
 
 - (void)makeWindowControllers
@@ -449,6 +1019,11 @@ void destroyCanvas(void *userData, OEComponent *canvas)
         [self showCanvas:[newCanvases objectAtIndex:i]];
 }
 
+- (NSArray *)canvasWindowControllers
+{
+    return canvasWindowControllers;
+}
+
 // Storage
 
 - (BOOL)canMountNow:(NSString *)path
@@ -569,6 +1144,32 @@ void destroyCanvas(void *userData, OEComponent *canvas)
     return success;
 }
 
+// Mounts are prepared one at a time, so they reach the emulation in order
+- (void)prepareMount:(NSString *)path
+             context:(id)theContext
+              target:(id)theTarget
+              action:(SEL)theAction
+{
+    if (!mountQueue)
+    {
+        mountQueue = [[NSOperationQueue alloc] init];
+        [mountQueue setMaxConcurrentOperationCount:1];
+    }
+    
+    MountOperation *operation = [[MountOperation alloc] initWithPath:path
+                                                             context:theContext
+                                                              target:theTarget
+                                                              action:theAction];
+    
+    MountProgressController *progressController;
+    progressController = [[MountProgressController alloc] initWithOperation:operation
+                                                                     window:[self windowForSheet]];
+    [progressController release];
+    
+    [mountQueue addOperation:operation];
+    [operation release];
+}
+
 - (BOOL)validateUserInterfaceItem:(id)anItem
 {
     SEL action = [anItem action];
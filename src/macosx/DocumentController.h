@@ -54,6 +54,13 @@
                                     error:(NSError **)outError;
 - (id)makeUntitledDocumentWithTemplateURL:(NSURL *)absoluteURL
                                     error:(NSError **)outError;
+- (id)openUntitledDocumentWithTemplateURL:(NSURL *)absoluteURL
+                              inputReplay:(NSString *)path
+                                  display:(BOOL)displayDocument
+                                    error:(NSError **)outError;
+- (id)makeUntitledDocumentWithTemplateURL:(NSURL *)absoluteURL
+                              inputReplay:(NSString *)path
+                                    error:(NSError **)outError;
 - (BOOL)openFile:(NSString *)path inWindow:(NSWindow *)window;
 
 - (void)lockEmulation;
@@ -16,9 +16,16 @@
 #import "TemplateChooserWindowController.h"
 #import "AudioControlsWindowController.h"
 #import "LibraryWindowController.h"
+#import "MountOperation.h"
+#import "CanvasView.h"
+#import "RemoteDisplayServer.h"
+#import "RenderRegression.h"
+#import "TextScreenScript.h"
+#import "PackageBlobStore.h"
 
 #import "PAAudio.h"
 #import "HIDJoystick.h"
+#import "InputRecorder.h"
 
 #define LINK_HELP       @"https://github.com/OpenEmulatorProject/OpenEmulator-OSX/wiki"
 #define LINK_HOMEPAGE	@"http://openemulatorproject.github.io/"
@@ -176,6 +183,11 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
                               [NSNumber numberWithFloat:1], @"OEAudioPlayVolume",
                               [NSNumber numberWithBool:YES], @"OEAudioPlayThrough",
                               [NSNumber numberWithBool:shaderDefault], @"OEVideoEnableShader",
+                              [NSNumber numberWithInt:CANVASVIEW_BACKGROUND_SKIPHIDDEN], @"OEVideoBackgroundPolicy",
+                              [NSNumber numberWithBool:NO], @"OERemoteDisplayAutoStart",
+                              [NSNumber numberWithInt:REMOTEDISPLAY_BASEPORT], @"OERemoteDisplayPort",
+                              [NSNumber numberWithInt:REMOTEDISPLAY_MAXFRAMERATE], @"OERemoteDisplayMaxFrameRate",
+                              [NSNumber numberWithInt:REMOTEDISPLAY_MAXBANDWIDTH], @"OERemoteDisplayMaxBandwidth",
                               nil
                               ];
     [userDefaults registerDefaults:defaults]; 
@@ -209,6 +221,18 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
 }
 - (void)applicationDidFinishLaunching:(NSNotification *)notification
 {
+    // Blobs of deleted or rewritten packages are removed in the background
+    [[PackageBlobStore sharedStore] collectBlobs];
+    
+    if ([RenderRegression isRequested])
+        [RenderRegression performSelector:@selector(runWithProcessArguments)
+                               withObject:nil
+                               afterDelay:0];
+    else if ([TextScreenScript isRequested])
+        [TextScreenScript performSelector:@selector(runWithProcessArguments)
+                               withObject:nil
+                               afterDelay:0];
+
 /*
     NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
     
@@ -274,10 +298,21 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
 */
 }
 
+- (BOOL)applicationShouldOpenUntitledFile:(NSApplication *)sender
+{
+    return (![RenderRegression isRequested] &&
+            ![TextScreenScript isRequested]);
+}
+
 - (void)applicationWillTerminate:(NSNotification *)sender
 {
     ((PAAudio *)paAudio)->close();
     
+    // Documents are not closed on quit, so forks are removed here
+    [[NSFileManager defaultManager] removeItemAtPath:[NSTemporaryDirectory()
+                                                      stringByAppendingPathComponent:FORKS_FOLDER]
+                                               error:nil];
+    
     NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
     [userDefaults setBool:[[fAudioControlsWindowController window] isVisible]
                    forKey:@"OEAudioControlsVisible"];
@@ -327,6 +362,38 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
     return [self openFile:path inWindow:window];
 }
 
+- (void)mountDidFail:(NSString *)path inDocument:(Document *)document
+{
+    if ([document canMount:path])
+    {
+        NSAlert *alert = [[NSAlert alloc] init];
+        [alert setMessageText:[NSString localizedStringWithFormat:
+                               @"The document \u201C%@\u201D can't be mounted "
+                               "in this emulation.",
+                               [path lastPathComponent]]];
+        [alert setInformativeText:[NSString localizedStringWithFormat:
+                                   @"The storage devices compatible with this "
+                                   "document are busy. "
+                                   "Try unmounting a storage device."]];
+        [alert runModal];
+        [alert release];
+        
+        return;
+    }
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:[NSString localizedStringWithFormat:
+                           @"The document \u201C%@\u201D can't be mounted "
+                           "in this emulation.",
+                           [path lastPathComponent]]];
+    [alert setInformativeText:[NSString localizedStringWithFormat:
+                               @"The document is not compatible with "
+                               "any storage device in this emulation. "
+                               "Try mounting the document in another emulation."]];
+    [alert runModal];
+    [alert release];
+}
+
 - (BOOL)openFile:(NSString *)path inWindow:(NSWindow *)window
 {
     NSString *pathExtension = [[path pathExtension] lowercaseString];
@@ -360,37 +427,19 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
     
     if ([diskImagePathExtensions containsObject:pathExtension])
     {
-        if ([document mount:path])
-            return YES;
-        
-        if ([document canMount:path])
+        // Incompatible images are reported right away; compatible ones
+        // are mounted once they are prepared
+        if (![document canMount:path])
         {
-            NSAlert *alert = [[NSAlert alloc] init];
-            [alert setMessageText:[NSString localizedStringWithFormat:
-                                   @"The document \u201C%@\u201D can't be mounted "
-                                   "in this emulation.",
-                                   [path lastPathComponent]]];
-            [alert setInformativeText:[NSString localizedStringWithFormat:
-                                       @"The storage devices compatible with this "
-                                       "document are busy. "
-                                       "Try unmounting a storage device."]];
-            [alert runModal];
-            [alert release];
+            [self mountDidFail:path inDocument:document];
             
-            return YES;
+            return NO;
         }
         
-        NSAlert *alert = [[NSAlert alloc] init];
-        [alert setMessageText:[NSString localizedStringWithFormat:
-                               @"The document \u201C%@\u201D can't be mounted "
-                               "in this emulation.",
-                               [path lastPathComponent]]];
-        [alert setInformativeText:[NSString localizedStringWithFormat:
-                                   @"The document is not compatible with "
-                                   "any storage device in this emulation. "
-                                   "Try mounting the document in another emulation."]];
-        [alert runModal];
-        [alert release];
+        [document prepareMount:path
+                       context:document
+                        target:self
+                        action:@selector(didPrepareMount:)];
         
         return YES;
     }
@@ -398,6 +447,18 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
     return NO;
 }
 
+- (void)didPrepareMount:(MountOperation *)operation
+{
+    if ([operation isCancelled])
+        return;
+    
+    NSString *path = [operation path];
+    Document *document = [operation context];
+    
+    if (![document mount:path])
+        [self mountDidFail:path inDocument:document];
+}
+
 - (void)observeValueForKeyPath:(NSString *)keyPath
                       ofObject:(id)object
                         change:(NSDictionary *)change
@@ -537,10 +598,22 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
 - (id)openUntitledDocumentWithTemplateURL:(NSURL *)absoluteURL
                                   display:(BOOL)displayDocument
                                     error:(NSError **)outError
+{
+    return [self openUntitledDocumentWithTemplateURL:absoluteURL
+                                         inputReplay:nil
+                                             display:displayDocument
+                                               error:outError];
+}
+
+- (id)openUntitledDocumentWithTemplateURL:(NSURL *)absoluteURL
+                              inputReplay:(NSString *)path
+                                  display:(BOOL)displayDocument
+                                    error:(NSError **)outError
 {
     NSDocument *document;
     
     document = [self makeUntitledDocumentWithTemplateURL:absoluteURL
+                                             inputReplay:path
                                                    error:outError];
     if (document)
     {
@@ -559,8 +632,18 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
 
 - (id)makeUntitledDocumentWithTemplateURL:(NSURL *)absoluteURL
                                     error:(NSError **)outError
+{
+    return [self makeUntitledDocumentWithTemplateURL:absoluteURL
+                                         inputReplay:nil
+                                               error:outError];
+}
+
+- (id)makeUntitledDocumentWithTemplateURL:(NSURL *)absoluteURL
+                              inputReplay:(NSString *)path
+                                    error:(NSError **)outError
 {
     Document *document = [[Document alloc] initWithTemplateURL:absoluteURL
+                                                   inputReplay:path
                                                          error:outError];
     if (document)
         return [document autorelease];
@@ -605,11 +688,25 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
     
     int deviceIndex = (int) [hidDevices indexOfObject:[NSValue valueWithPointer:device]];
     
+    // The joystick is shared, so every document records its events
+    NSMutableArray *inputRecorders = [NSMutableArray array];
+    for (Document *document in [self documents])
+    {
+        if ([document inputRecorder])
+            [inputRecorders addObject:[NSValue valueWithPointer:[document inputRecorder]]];
+    }
+    
     [self lockEmulation];
     
     if (usagePage == 0x9)
+    {
         ((HIDJoystick *)hidJoystick)->setButton(deviceIndex, usageId - 1,
                                                 intValue);
+        
+        for (NSValue *value in inputRecorders)
+            ((InputRecorder *)[value pointerValue])->recordJoystickButton(deviceIndex, usageId - 1,
+                                                                          (OEInt) intValue);
+    }
     else if (usagePage == 0x1)
     {
         if ((usageId >= 0x30) && (usageId <= 0x38))
@@ -617,9 +714,19 @@ void hidDeviceEventOcurred(void *inContext, IOReturn inResult, void *inSender, I
             float normalizedValue = (float) (intValue - min) / (float) (max - min);
             
             ((HIDJoystick *)hidJoystick)->setAxis(deviceIndex, usageId - 0x30, normalizedValue);
+            
+            for (NSValue *value in inputRecorders)
+                ((InputRecorder *)[value pointerValue])->recordJoystickAxis(deviceIndex, usageId - 0x30,
+                                                                            normalizedValue);
         }
         else if (usageId == 0x39)
+        {
             ((HIDJoystick *)hidJoystick)->setHat(deviceIndex, usageId - 0x39, (OEInt) intValue);
+            
+            for (NSValue *value in inputRecorders)
+                ((InputRecorder *)[value pointerValue])->recordJoystickHat(deviceIndex, usageId - 0x39,
+                                                                           (OEInt) intValue);
+        }
     }
     
     [self unlockEmulation];
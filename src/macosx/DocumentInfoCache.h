@@ -0,0 +1,34 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Document Info Cache
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Caches parsed emulation document headers
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define DOCUMENTINFOCACHE_FOLDER    @"~/Library/Caches/OpenEmulator"
+#define DOCUMENTINFOCACHE_FILE      @"DocumentInfo.plist"
+#define DOCUMENTINFOCACHE_VERSION   3
+#define DOCUMENTINFOCACHE_MAXCOUNT  1024
+#define DOCUMENTINFOCACHE_MAXAGE    32
+
+@interface DocumentInfoCache : NSObject
+{
+    NSString *cachePath;
+    NSMutableDictionary *entries;
+    BOOL entriesChanged;
+    NSInteger launchNum;
+}
+
++ (DocumentInfoCache *)sharedCache;
+
+- (NSDictionary *)infoForPath:(NSString *)path;
+- (void)synchronize;
+
++ (int)runBenchmarkWithArguments:(NSArray *)arguments;
+
+@end
@@ -0,0 +1,386 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Document Info Cache
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Caches parsed emulation document headers
+ */
+
+#import <CommonCrypto/CommonDigest.h>
+
+#import "DocumentInfoCache.h"
+
+#import "NSStringAdditions.h"
+
+#import "OEDocument.h"
+
+#define DOCUMENTINFOCACHE_PACKAGEFILE   @"info.xml"
+#define DOCUMENTINFOCACHE_SAVEDELAY     2.0
+
+@implementation DocumentInfoCache
+
++ (DocumentInfoCache *)sharedCache
+{
+    static DocumentInfoCache *sharedCache = nil;
+    
+    @synchronized(self)
+    {
+        if (!sharedCache)
+            sharedCache = [[DocumentInfoCache alloc] init];
+    }
+    
+    return sharedCache;
+}
+
+// Entries not used in the last DOCUMENTINFOCACHE_MAXAGE launches are
+// dropped, and the least recently used ones beyond DOCUMENTINFOCACHE_MAXCOUNT
+- (BOOL)pruneEntries
+{
+    BOOL pruned = NO;
+    
+    NSArray *keys = [entries keysSortedByValueUsingComparator:^(id a, id b) {
+        return [[a objectForKey:@"launchNum"] compare:[b objectForKey:@"launchNum"]];
+    }];
+    
+    NSInteger removeNum = (NSInteger) [keys count] - DOCUMENTINFOCACHE_MAXCOUNT;
+    for (NSString *key in keys)
+    {
+        NSInteger entryLaunchNum = [[[entries objectForKey:key] objectForKey:@"launchNum"]
+                                    integerValue];
+        
+        if ((removeNum <= 0) &&
+            (entryLaunchNum > launchNum - DOCUMENTINFOCACHE_MAXAGE))
+            break;
+        
+        [entries removeObjectForKey:key];
+        removeNum--;
+        
+        pruned = YES;
+    }
+    
+    return pruned;
+}
+
+- (void)entriesDidChange
+{
+    if (entriesChanged)
+        return;
+    
+    entriesChanged = YES;
+    
+    [self performSelectorOnMainThread:@selector(scheduleSynchronize)
+                           withObject:nil
+                        waitUntilDone:NO];
+}
+
+- (id)init
+{
+    NSString *folderPath = [DOCUMENTINFOCACHE_FOLDER stringByExpandingTildeInPath];
+    
+    return [self initWithPath:[folderPath stringByAppendingPathComponent:DOCUMENTINFOCACHE_FILE]];
+}
+
+// A nil path keeps the cache in memory only
+- (id)initWithPath:(NSString *)path
+{
+    self = [super init];
+    
+    if (self)
+    {
+        cachePath = [path copy];
+        
+        NSDictionary *dict = path ? [NSDictionary dictionaryWithContentsOfFile:cachePath] : nil;
+        if ([[dict objectForKey:@"version"] intValue] == DOCUMENTINFOCACHE_VERSION)
+        {
+            entries = [[dict objectForKey:@"entries"] mutableCopy];
+            launchNum = [[dict objectForKey:@"launchNum"] integerValue];
+        }
+        
+        if (!entries)
+            entries = [[NSMutableDictionary alloc] init];
+        
+        launchNum++;
+        
+        if ([self pruneEntries])
+            [self entriesDidChange];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [cachePath release];
+    [entries release];
+    
+    [super dealloc];
+}
+
+- (NSString *)hashForPath:(NSString *)path
+{
+    BOOL isDirectory;
+    if (![[NSFileManager defaultManager] fileExistsAtPath:path
+                                              isDirectory:&isDirectory])
+        return nil;
+    
+    // Packages are described by their info.xml
+    if (isDirectory)
+        path = [path stringByAppendingPathComponent:DOCUMENTINFOCACHE_PACKAGEFILE];
+    
+    NSData *data = [NSData dataWithContentsOfFile:path
+                                          options:NSDataReadingMappedIfSafe
+                                            error:nil];
+    if (!data)
+        return nil;
+    
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1([data bytes], (CC_LONG) [data length], digest);
+    
+    NSMutableString *hash = [NSMutableString string];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++)
+        [hash appendFormat:@"%02x", digest[i]];
+    
+    return hash;
+}
+
+// Resources referenced by a package, such as ROMs and fonts, are kept
+// so documents can read them ahead when opening
+- (NSArray *)resourcesForPackage:(NSString *)path
+{
+    NSMutableArray *resources = [NSMutableArray array];
+    
+    NSData *data = [NSData dataWithContentsOfFile:
+                    [path stringByAppendingPathComponent:DOCUMENTINFOCACHE_PACKAGEFILE]];
+    if (!data)
+        return resources;
+    
+    NSXMLDocument *xmlDocument = [[[NSXMLDocument alloc] initWithData:data
+                                                              options:0
+                                                                error:nil] autorelease];
+    NSArray *nodes = [xmlDocument nodesForXPath:@"//@value" error:nil];
+    for (NSXMLNode *node in nodes)
+    {
+        NSString *value = [node stringValue];
+        if ([value rangeOfString:@"/"].length &&
+            ![resources containsObject:value])
+            [resources addObject:value];
+    }
+    
+    return resources;
+}
+
+- (NSDictionary *)parseDocument:(NSString *)path
+{
+    OEDocument oeDocument;
+    oeDocument.open([path cppString]);
+    if (!oeDocument.isOpen())
+        return nil;
+    
+    OEHeaderInfo headerInfo = oeDocument.getHeaderInfo();
+    OEConnectorInfos connectorInfos = oeDocument.getFreeConnectorInfos();
+    
+    oeDocument.close();
+    
+    NSMutableDictionary *info = [NSMutableDictionary dictionary];
+    [info setObject:[NSString stringWithCPPString:headerInfo.image]
+             forKey:@"image"];
+    [info setObject:[NSString stringWithCPPString:headerInfo.description]
+             forKey:@"description"];
+    [info setObject:[NSNumber numberWithInteger:connectorInfos.size()]
+             forKey:@"connectorNum"];
+    
+    if (connectorInfos.size() == 1)
+    {
+        OEConnectorInfos::iterator i = connectorInfos.begin();
+        
+        [info setObject:[NSString stringWithCPPString:i->type]
+                 forKey:@"connectorType"];
+        [info setObject:[NSString stringWithCPPString:i->id]
+                 forKey:@"connectorId"];
+    }
+    
+    BOOL isDirectory;
+    if ([[NSFileManager defaultManager] fileExistsAtPath:path
+                                             isDirectory:&isDirectory] &&
+        isDirectory)
+        [info setObject:[self resourcesForPackage:path]
+                 forKey:@"resources"];
+    
+    return info;
+}
+
+- (void)setInfo:(NSDictionary *)info forHash:(NSString *)hash
+{
+    [entries setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                        info, @"info",
+                        [NSNumber numberWithInteger:launchNum], @"launchNum",
+                        nil]
+                forKey:hash];
+    
+    [self entriesDidChange];
+}
+
+- (NSDictionary *)infoForPath:(NSString *)path
+{
+    NSString *hash = [self hashForPath:path];
+    
+    NSDictionary *info = nil;
+    
+    @synchronized(self)
+    {
+        NSDictionary *entry = hash ? [entries objectForKey:hash] : nil;
+        info = [[[entry objectForKey:@"info"] retain] autorelease];
+        
+        // Entries used in this launch are kept when pruning
+        if (info &&
+            ([[entry objectForKey:@"launchNum"] integerValue] != launchNum))
+            [self setInfo:info forHash:hash];
+    }
+    
+    if (info)
+        return info;
+    
+    info = [self parseDocument:path];
+    
+    @synchronized(self)
+    {
+        if (hash && info)
+            [self setInfo:info forHash:hash];
+    }
+    
+    return info;
+}
+
+- (void)scheduleSynchronize
+{
+    [self performSelector:@selector(synchronize)
+               withObject:nil
+               afterDelay:DOCUMENTINFOCACHE_SAVEDELAY];
+}
+
+- (void)synchronize
+{
+    NSData *data = nil;
+    
+    @synchronized(self)
+    {
+        if (!entriesChanged || !cachePath)
+            return;
+        
+        entriesChanged = NO;
+        
+        NSDictionary *dict = [NSDictionary dictionaryWithObjectsAndKeys:
+                              [NSNumber numberWithInt:DOCUMENTINFOCACHE_VERSION], @"version",
+                              [NSNumber numberWithInteger:launchNum], @"launchNum",
+                              entries, @"entries",
+                              nil];
+        data = [NSPropertyListSerialization dataWithPropertyList:dict
+                                                          format:NSPropertyListBinaryFormat_v1_0
+                                                         options:0
+                                                           error:nil];
+    }
+    
+    if (!data)
+        return;
+    
+    [[NSFileManager defaultManager] createDirectoryAtPath:[cachePath stringByDeletingLastPathComponent]
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    [data writeToFile:cachePath atomically:YES];
+}
+
++ (int)runBenchmarkWithArguments:(NSArray *)arguments
+{
+    NSString *resourcePath = [[NSBundle mainBundle] resourcePath];
+    if ([arguments count])
+        resourcePath = [arguments objectAtIndex:0];
+    
+    // Templates are packages, library entries are plain documents
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSMutableArray *paths = [NSMutableArray array];
+    
+    NSString *templatesPath = [resourcePath stringByAppendingPathComponent:@"templates"];
+    NSDirectoryEnumerator *dirEnum = [fileManager enumeratorAtPath:templatesPath];
+    NSString *path;
+    while ((path = [dirEnum nextObject]))
+    {
+        if ([[path pathExtension] isEqualToString:@"emulation"])
+        {
+            [paths addObject:[templatesPath stringByAppendingPathComponent:path]];
+            
+            [dirEnum skipDescendents];
+        }
+    }
+    
+    NSUInteger templateNum = [paths count];
+    
+    NSString *libraryPath = [resourcePath stringByAppendingPathComponent:@"library"];
+    dirEnum = [fileManager enumeratorAtPath:libraryPath];
+    while ((path = [dirEnum nextObject]))
+    {
+        if ([[path pathExtension] isEqualToString:@"xml"])
+            [paths addObject:[libraryPath stringByAppendingPathComponent:path]];
+    }
+    
+    if (![paths count])
+    {
+        fprintf(stderr, "no documents found in %s\n", [resourcePath fileSystemRepresentation]);
+        
+        return 1;
+    }
+    
+    printf("%lu templates, %lu library documents\n",
+           (unsigned long) templateNum,
+           (unsigned long) ([paths count] - templateNum));
+    
+    // The user's cache is left untouched
+    DocumentInfoCache *cache = [[[DocumentInfoCache alloc] initWithPath:nil] autorelease];
+    
+    NSMutableArray *infos = [NSMutableArray arrayWithCapacity:[paths count]];
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
+    for (NSString *thePath in paths)
+    {
+        NSDictionary *info = [cache parseDocument:thePath];
+        
+        [infos addObject:info ? info : (id)[NSNull null]];
+    }
+    
+    CFAbsoluteTime parsedTime = CFAbsoluteTimeGetCurrent();
+    
+    for (NSString *thePath in paths)
+        [cache infoForPath:thePath];
+    
+    CFAbsoluteTime filledTime = CFAbsoluteTimeGetCurrent();
+    
+    NSUInteger mismatchNum = 0;
+    for (NSUInteger i = 0; i < [paths count]; i++)
+    {
+        NSDictionary *info = [cache infoForPath:[paths objectAtIndex:i]];
+        
+        if (![[infos objectAtIndex:i] isEqual:info ? info : (id)[NSNull null]])
+            mismatchNum++;
+    }
+    
+    CFAbsoluteTime cachedTime = CFAbsoluteTimeGetCurrent();
+    
+    printf("cold parse %.2f ms, first lookup %.2f ms, cached lookup %.2f ms\n",
+           (parsedTime - startTime) * 1000,
+           (filledTime - parsedTime) * 1000,
+           (cachedTime - filledTime) * 1000);
+    
+    if (mismatchNum)
+    {
+        fprintf(stderr, "result mismatch: %lu cached entries differ\n", (unsigned long) mismatchNum);
+        
+        return 1;
+    }
+    
+    return 0;
+}
+
+@end
@@ -11,6 +11,7 @@
 #import <Cocoa/Cocoa.h>
 
 #import "Document.h"
+#import "SettingsTransaction.h"
 
 typedef enum
 {
@@ -96,6 +97,8 @@ typedef enum
 - (NSString *)typeForSettingAtIndex:(NSInteger)index;
 - (NSArray *)optionsForSettingAtIndex:(NSInteger)index;
 - (void)setValue:(NSString *)value forSettingAtIndex:(NSInteger)index;
+- (void)setValue:(NSString *)value forSettingAtIndex:(NSInteger)index
+   inTransaction:(SettingsTransaction *)transaction;
 - (NSString *)valueForSettingAtIndex:(NSInteger)index;
 
 - (BOOL)isRemovable;
@@ -11,6 +11,9 @@
 #import "EmulationItem.h"
 
 #import "NSStringAdditions.h"
+#import "DocumentInfoCache.h"
+#import "ImageCache.h"
+#import "SettingsTransaction.h"
 
 #import "OEEmulation.h"
 
@@ -163,7 +166,7 @@
         ((OEComponent *)device)->postMessage(NULL, DEVICE_GET_IMAGEPATH, &value);
         NSString *imagePath = [resourcePath stringByAppendingPathComponent:
                                [NSString stringWithCPPString:value]];
-        image = [[NSImage alloc] initByReferencingFile:imagePath];
+        image = [[[ImageCache sharedCache] imageForPath:imagePath] retain];
         
         ((OEComponent *)device)->postMessage(NULL, DEVICE_GET_LOCATIONLABEL, &value);
         locationLabel = [[NSString stringWithCPPString:value] retain];
@@ -282,7 +285,7 @@
         }
         NSString *resourcePath = [[NSUserDefaults standardUserDefaults] URLForKey:@"OEDefaultResourcesPath"].path;
         NSString *imagePath = [resourcePath stringByAppendingPathComponent:theImagePath];
-        image = [[NSImage alloc] initByReferencingFile:imagePath];
+        image = [[[ImageCache sharedCache] imageForPath:imagePath] retain];
         
         label = [thePortType copy];
         stateLabel = @"";
@@ -422,7 +425,20 @@
     return [settingsOptions objectAtIndex:index];
 }
 
+// Edits are committed as a transaction of one, so a value whose component
+// fails to update is reverted rather than left half applied
 - (void)setValue:(NSString *)value forSettingAtIndex:(NSInteger)index;
+{
+    SettingsTransaction *transaction = [[SettingsTransaction alloc] initWithDocument:document];
+    
+    [self setValue:value forSettingAtIndex:index inTransaction:transaction];
+    [transaction commit];
+    
+    [transaction release];
+}
+
+- (void)setValue:(NSString *)value forSettingAtIndex:(NSInteger)index
+   inTransaction:(SettingsTransaction *)transaction
 {
     OEComponent *settingComponent = (OEComponent *) [[settingsComponent objectAtIndex:index]
                                                      pointerValue];
@@ -434,13 +450,7 @@
         value = [settingOptionKeys objectAtIndex:[value integerValue]];
     }
     
-    [document lockEmulation];
-    
-    if (settingComponent &&
-        settingComponent->setValue([settingName cppString], [value cppString]))
-        settingComponent->update();
-    
-    [document unlockEmulation];
+    [transaction setValue:value forSetting:settingName ofComponent:settingComponent];
 }
 
 - (NSString *)valueForSettingAtIndex:(NSInteger)index
@@ -655,21 +665,14 @@
 
 - (BOOL)addOEDocument:(NSString *)thePath
 {
-    OEDocument oeDocument;
-    oeDocument.open([thePath cppString]);
-    if (!oeDocument.isOpen())
+    NSDictionary *info = [[DocumentInfoCache sharedCache] infoForPath:thePath];
+    if (!info)
         return NO;
     
-    OEConnectorInfos connectorInfos = oeDocument.getFreeConnectorInfos();
-    
-    oeDocument.close();
-    
-    if (connectorInfos.size() == 1)
+    if ([[info objectForKey:@"connectorNum"] integerValue] == 1)
     {
-        OEConnectorInfos::iterator i = connectorInfos.begin();
-        
         map<string, string> idMap;
-        idMap[[portId cppString]] = i->id;
+        idMap[[portId cppString]] = [[info objectForKey:@"connectorId"] cppString];
         
         [document captureNewCanvases:YES];
         
@@ -15,6 +15,7 @@
 #import "EmulationOutlineCell.h"
 #import "VerticallyCenteredTextFieldCell.h"
 #import "DocumentController.h"
+#import "MountOperation.h"
 
 #define SPLIT_VERT_LEFT_MIN 128
 #define SPLIT_VERT_RIGHT_MIN 351
@@ -586,11 +587,7 @@ objectValueForTableColumn:(NSTableColumn *)tableColumn
         
         NSString *pathExtension = [[path pathExtension] lowercaseString];
         if ([[documentController diskImagePathExtensions] containsObject:pathExtension])
-        {
-            [self mount:path inItem:item];
-            
-            return YES;
-        }
+            return [self mount:path inItem:item];
     }
     else if ([[pboard types] containsObject:@"OEDeviceType"])
     {
@@ -846,26 +843,50 @@ dataCellForTableColumn:(NSTableColumn *)tableColumn
     [dict release];
 }
 
+- (void)mountDidFail:(NSString *)path inItem:(EmulationItem *)item
+{
+    NSBeginAlertSheet([NSString localizedStringWithFormat:
+                       @"The document \u201C%@\u201D can't be mounted "
+                       "in \u201C%@\u201D.",
+                       [path lastPathComponent], [item label]],
+                      nil, nil, nil,
+                      [self window],
+                      self, nil, nil, nil,
+                      [NSString localizedStringWithFormat:
+                       @"Try mounting the document in some other device."]);
+}
+
 - (BOOL)doMount:(NSString *)path inItem:(EmulationItem *)item
 {
-    if (![item mount:path])
+    // Refused images are reported right away; accepted ones are mounted
+    // once they are prepared
+    if (![item canMount:path])
     {
-        NSBeginAlertSheet([NSString localizedStringWithFormat:
-                           @"The document \u201C%@\u201D can't be mounted "
-                           "in \u201C%@\u201D.",
-                           [path lastPathComponent], [item label]],
-                          nil, nil, nil,
-                          [self window],
-                          self, nil, nil, nil,
-                          [NSString localizedStringWithFormat:
-                           @"Try mounting the document in some other device."]);
+        [self mountDidFail:path inItem:item];
         
         return NO;
     }
     
+    [document prepareMount:path
+                   context:item
+                    target:self
+                    action:@selector(didPrepareMount:)];
+    
     return YES;
 }
 
+- (void)didPrepareMount:(MountOperation *)operation
+{
+    if ([operation isCancelled])
+        return;
+    
+    NSString *path = [operation path];
+    EmulationItem *item = [operation context];
+    
+    if (![item mount:path])
+        [self mountDidFail:path inItem:item];
+}
+
 - (IBAction)unmount:(id)sender
 {
     EmulationItem *item = [self itemForSender:sender];
@@ -0,0 +1,180 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Frame Barrier
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Holds the emulation at a fixed emulated cycle
+ */
+
+#include <sys/time.h>
+
+#include "FrameBarrier.h"
+
+#include "OEEmulation.h"
+
+#include "AudioInterface.h"
+#include "ControlBusInterface.h"
+
+#define FRAMEBARRIER_CONTROLBUS "controlBus"
+
+static void getDeadline(struct timespec *deadline, double timeout)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    
+    double deadlineTime = now.tv_sec + now.tv_usec * 1E-6 + timeout;
+    deadline->tv_sec = (time_t) deadlineTime;
+    deadline->tv_nsec = (long) ((deadlineTime - deadline->tv_sec) * 1E9);
+}
+
+FrameBarrier::FrameBarrier()
+{
+    emulation = NULL;
+    audio = NULL;
+    
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    
+    targetCycles = 0;
+    heldCycles = 0;
+    isWaiting = false;
+    isHolding = false;
+    isHoldTimedOut = false;
+}
+
+FrameBarrier::~FrameBarrier()
+{
+    setAudio(NULL);
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+void FrameBarrier::setEmulation(OEEmulation *emulation)
+{
+    this->emulation = emulation;
+}
+
+// Must be called with the emulation locked
+void FrameBarrier::setAudio(OEComponent *audio)
+{
+    if (this->audio)
+        this->audio->removeObserver(this, AUDIO_FRAME_DID_RENDER);
+    
+    this->audio = audio;
+    
+    if (audio)
+        audio->addObserver(this, AUDIO_FRAME_DID_RENDER);
+}
+
+// Must be called without the emulation lock, so the emulation can run up
+// to the requested cycle. On success the emulation stays held at that step
+// boundary until release() is called.
+bool FrameBarrier::waitForCycles(OELong cycles, float timeout)
+{
+    struct timespec deadline;
+    getDeadline(&deadline, timeout);
+    
+    pthread_mutex_lock(&mutex);
+    
+    targetCycles = cycles;
+    isWaiting = true;
+    isHolding = false;
+    isHoldTimedOut = false;
+    
+    while (!isHolding)
+    {
+        if (pthread_cond_timedwait(&cond, &mutex, &deadline))
+            break;
+    }
+    
+    bool value = isHolding;
+    if (!value)
+        isWaiting = false;
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return value;
+}
+
+OELong FrameBarrier::getHeldCycles()
+{
+    pthread_mutex_lock(&mutex);
+    
+    OELong value = heldCycles;
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return value;
+}
+
+// Returns false if the hold had already timed out, so the emulation may
+// have run on while the caller expected it to be held
+bool FrameBarrier::release()
+{
+    pthread_mutex_lock(&mutex);
+    
+    bool value = !isHoldTimedOut;
+    
+    isWaiting = false;
+    isHolding = false;
+    isHoldTimedOut = false;
+    
+    pthread_cond_broadcast(&cond);
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return value;
+}
+
+void FrameBarrier::notify(OEComponent *sender, int notification, void *data)
+{
+    // Called with the emulation locked, after a frame was rendered
+    pthread_mutex_lock(&mutex);
+    
+    if (isWaiting && !isHolding)
+    {
+        OELong cycles = getCycles();
+        
+        if (cycles >= targetCycles)
+        {
+            heldCycles = cycles;
+            isHolding = true;
+            
+            pthread_cond_broadcast(&cond);
+            
+            struct timespec deadline;
+            getDeadline(&deadline, FRAMEBARRIER_HOLD_TIMEOUT);
+            
+            while (isHolding)
+            {
+                if (pthread_cond_timedwait(&cond, &mutex, &deadline))
+                {
+                    isWaiting = false;
+                    isHolding = false;
+                    isHoldTimedOut = true;
+                    
+                    break;
+                }
+            }
+        }
+    }
+    
+    pthread_mutex_unlock(&mutex);
+}
+
+OELong FrameBarrier::getCycles()
+{
+    OELong cycles = 0;
+    
+    if (!emulation)
+        return cycles;
+    
+    OEComponent *controlBus = emulation->getComponent(FRAMEBARRIER_CONTROLBUS);
+    if (controlBus)
+        controlBus->postMessage(this, CONTROLBUS_GET_CYCLES, &cycles);
+    
+    return cycles;
+}
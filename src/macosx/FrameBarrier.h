@@ -0,0 +1,54 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Frame Barrier
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Holds the emulation at a fixed emulated cycle
+ */
+
+#ifndef _FRAMEBARRIER_H
+#define _FRAMEBARRIER_H
+
+#include <pthread.h>
+
+#include "OEComponent.h"
+
+class OEEmulation;
+
+// Seconds the emulation is held before it is resumed regardless
+#define FRAMEBARRIER_HOLD_TIMEOUT   10.0
+
+class FrameBarrier : public OEComponent
+{
+public:
+    FrameBarrier();
+    ~FrameBarrier();
+    
+    void setEmulation(OEEmulation *emulation);
+    void setAudio(OEComponent *audio);
+    
+    bool waitForCycles(OELong cycles, float timeout);
+    OELong getHeldCycles();
+    bool release();
+    
+    void notify(OEComponent *sender, int notification, void *data);
+
+private:
+    OEEmulation *emulation;
+    OEComponent *audio;
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    
+    OELong targetCycles;
+    OELong heldCycles;
+    bool isWaiting;
+    bool isHolding;
+    bool isHoldTimedOut;
+    
+    OELong getCycles();
+};
+
+#endif
@@ -0,0 +1,25 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Image Cache
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shares artwork images between items and documents
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define IMAGECACHE_MAXCOUNT 256
+
+@interface ImageCache : NSObject
+{
+    NSMutableDictionary *entries;
+    NSMutableArray *keys;
+}
+
++ (ImageCache *)sharedCache;
+
+- (NSImage *)imageForPath:(NSString *)path;
+
+@end
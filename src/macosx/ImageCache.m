@@ -0,0 +1,101 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Image Cache
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shares artwork images between items and documents
+ */
+
+#import "ImageCache.h"
+
+@implementation ImageCache
+
++ (ImageCache *)sharedCache
+{
+    static ImageCache *sharedCache = nil;
+    
+    @synchronized(self)
+    {
+        if (!sharedCache)
+            sharedCache = [[ImageCache alloc] init];
+    }
+    
+    return sharedCache;
+}
+
+- (id)init
+{
+    self = [super init];
+    
+    if (self)
+    {
+        entries = [[NSMutableDictionary alloc] init];
+        keys = [[NSMutableArray alloc] init];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [entries release];
+    [keys release];
+    
+    [super dealloc];
+}
+
+// Entries only drop the reference of the cache. Items that retained an
+// image keep it alive after it is evicted.
+- (void)evictImages
+{
+    while ([keys count] > IMAGECACHE_MAXCOUNT)
+    {
+        [entries removeObjectForKey:[keys objectAtIndex:0]];
+        [keys removeObjectAtIndex:0];
+    }
+}
+
+// Images reference their file and keep all of its representations, so
+// AppKit decodes them when first drawn, at the size they are drawn at.
+// Every user of a path shares the same image and its decoded data.
+- (NSImage *)imageForPath:(NSString *)path
+{
+    if (!path)
+        return nil;
+    
+    NSString *key = [path stringByResolvingSymlinksInPath];
+    
+    @synchronized(self)
+    {
+        NSImage *image = [entries objectForKey:key];
+        if (image)
+        {
+            // Move to the most recently used end
+            [keys removeObject:key];
+            [keys addObject:key];
+            
+            return [[image retain] autorelease];
+        }
+        
+        BOOL isDirectory;
+        if (![[NSFileManager defaultManager] fileExistsAtPath:key
+                                                  isDirectory:&isDirectory] ||
+            isDirectory)
+            return nil;
+        
+        image = [[[NSImage alloc] initByReferencingFile:key] autorelease];
+        if (!image)
+            return nil;
+        
+        [entries setObject:image forKey:key];
+        [keys addObject:key];
+        
+        [self evictImages];
+        
+        return image;
+    }
+}
+
+@end
@@ -0,0 +1,655 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Input Recorder
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Records and replays emulation input
+ */
+
+#include <cstring>
+
+#include "InputRecorder.h"
+
+#include "OEEmulation.h"
+#include "OpenGLCanvas.h"
+
+#include "AudioInterface.h"
+#include "ControlBusInterface.h"
+
+#define INPUTRECORDER_CONTROLBUS    "controlBus"
+#define INPUTRECORDER_NOTARGET      0xff
+
+static void writeVarint(FILE *fp, OELong value)
+{
+    unsigned long long v = (unsigned long long) value;
+    
+    do
+    {
+        OEChar c = v & 0x7f;
+        v >>= 7;
+        
+        if (v)
+            c |= 0x80;
+        
+        fputc(c, fp);
+    } while (v);
+}
+
+static bool readVarint(FILE *fp, OELong& value)
+{
+    unsigned long long v = 0;
+    
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = fgetc(fp);
+        if (c == EOF)
+            return false;
+        
+        v |= (unsigned long long) (c & 0x7f) << shift;
+        
+        if (!(c & 0x80))
+        {
+            value = (OELong) v;
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void writeFloat(FILE *fp, float value)
+{
+    OEUInt32 v;
+    memcpy(&v, &value, sizeof(v));
+    
+    for (int i = 0; i < 4; i++)
+        fputc((v >> (i * 8)) & 0xff, fp);
+}
+
+static bool readFloat(FILE *fp, float& value)
+{
+    OEUInt32 v = 0;
+    
+    for (int i = 0; i < 4; i++)
+    {
+        int c = fgetc(fp);
+        if (c == EOF)
+            return false;
+        
+        v |= (OEUInt32) c << (i * 8);
+    }
+    
+    memcpy(&value, &v, sizeof(v));
+    
+    return true;
+}
+
+static bool readInt(FILE *fp, OEInt& value)
+{
+    OELong v;
+    if (!readVarint(fp, v))
+        return false;
+    
+    value = (OEInt) v;
+    
+    return true;
+}
+
+InputRecorder::InputRecorder()
+{
+    emulation = NULL;
+    audio = NULL;
+    
+    recordingFile = NULL;
+    recordingCycles = 0;
+    
+    openCycles = 0;
+    
+    replaying = false;
+    replayIndex = 0;
+}
+
+InputRecorder::~InputRecorder()
+{
+    stopRecording();
+    
+    if (audio)
+        audio->removeObserver(this, AUDIO_FRAME_WILL_RENDER);
+}
+
+void InputRecorder::setEmulation(OEEmulation *emulation)
+{
+    this->emulation = emulation;
+}
+
+void InputRecorder::setAudio(OEComponent *audio)
+{
+    if (this->audio)
+        this->audio->removeObserver(this, AUDIO_FRAME_WILL_RENDER);
+    
+    this->audio = audio;
+    
+    if (audio)
+        audio->addObserver(this, AUDIO_FRAME_WILL_RENDER);
+}
+
+// Must be called with the emulation locked, right after it was opened.
+// Recordings start with a snapshot of the machine, and are replayed on a
+// fresh emulation opened from that snapshot, anchored at this cycle. A
+// loaded replay is armed here, before the emulation runs its first step.
+void InputRecorder::markOpen()
+{
+    openCycles = getCycles();
+    
+    if (replayEvents.empty())
+        return;
+    
+    for (OEInt i = 0; i < replayEvents.size(); i++)
+        replayEvents[i].cycles += openCycles;
+    
+    replayIndex = 0;
+    replaying = true;
+}
+
+void InputRecorder::addCanvas(OEComponent *canvas)
+{
+    canvases.push_back(canvas);
+}
+
+void InputRecorder::removeCanvas(OEComponent *canvas)
+{
+    // Keep indices stable, so targets of later canvases stay valid
+    for (OEComponents::iterator i = canvases.begin();
+         i != canvases.end();
+         i++)
+    {
+        if (*i == canvas)
+            *i = NULL;
+    }
+}
+
+bool InputRecorder::startRecording(string path)
+{
+    stopRecording();
+    
+    recordingFile = fopen(path.c_str(), "wb");
+    if (!recordingFile)
+        return false;
+    
+    fwrite(INPUTRECORDER_SIGNATURE, 1, 4, recordingFile);
+    fputc(INPUTRECORDER_VERSION, recordingFile);
+    
+    recordingCycles = getCycles();
+    
+    // The absolute starting cycle is kept for diagnostics
+    writeVarint(recordingFile, recordingCycles);
+    
+    return true;
+}
+
+void InputRecorder::stopRecording()
+{
+    if (!recordingFile)
+        return;
+    
+    fclose(recordingFile);
+    recordingFile = NULL;
+}
+
+bool InputRecorder::isRecording()
+{
+    return (recordingFile != NULL);
+}
+
+// Must be called before the emulation is opened, see markOpen()
+bool InputRecorder::loadReplay(string path)
+{
+    stopReplay();
+    
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp)
+        return false;
+    
+    char signature[4];
+    OELong startCycles;
+    
+    bool success = ((fread(signature, 1, 4, fp) == 4) &&
+                    !memcmp(signature, INPUTRECORDER_SIGNATURE, 4) &&
+                    (fgetc(fp) == INPUTRECORDER_VERSION) &&
+                    readVarint(fp, startCycles));
+    
+    // Events are stamped relative to the recording start, and replayed
+    // relative to the opening of the snapshot taken at that start. The
+    // absolute starting cycle only matches if the snapshot restores the
+    // cycle counter, so it is not used as the anchor.
+    OELong cycles = 0;
+    
+    while (success)
+    {
+        InputRecorderEvent event;
+        OELong delta;
+        
+        if (!readVarint(fp, delta))
+            break;
+        
+        int type = fgetc(fp);
+        int target = fgetc(fp);
+        
+        if ((type == EOF) || (target == EOF))
+        {
+            success = false;
+            
+            break;
+        }
+        
+        cycles += delta;
+        
+        event.cycles = cycles;
+        event.type = type;
+        event.target = target;
+        event.index = 0;
+        event.value = 0;
+        event.x = 0;
+        event.y = 0;
+        
+        switch (type)
+        {
+            case INPUTRECORDER_KEY:
+            case INPUTRECORDER_MOUSEBUTTON:
+            case INPUTRECORDER_JOYSTICKBUTTON:
+            case INPUTRECORDER_JOYSTICKHAT:
+                success = (readInt(fp, event.index) &&
+                           readInt(fp, event.value));
+                
+                break;
+            
+            case INPUTRECORDER_UNICODECHAR:
+                success = readInt(fp, event.value);
+                
+                break;
+            
+            case INPUTRECORDER_MOUSEENTER:
+            case INPUTRECORDER_MOUSEEXIT:
+                break;
+            
+            case INPUTRECORDER_MOUSEPOSITION:
+            case INPUTRECORDER_MOUSEMOVE:
+                success = (readFloat(fp, event.x) &&
+                           readFloat(fp, event.y));
+                
+                break;
+            
+            case INPUTRECORDER_MOUSEWHEEL:
+            case INPUTRECORDER_JOYSTICKAXIS:
+                success = (readInt(fp, event.index) &&
+                           readFloat(fp, event.x));
+                
+                break;
+            
+            case INPUTRECORDER_PASTE:
+            {
+                OEInt length;
+                success = readInt(fp, length);
+                
+                for (OEInt i = 0; success && (i < length); i++)
+                {
+                    OEInt c;
+                    success = readInt(fp, c);
+                    
+                    event.text += (wchar_t) c;
+                }
+                
+                break;
+            }
+            
+            default:
+                success = false;
+                
+                break;
+        }
+        
+        if (success)
+            replayEvents.push_back(event);
+    }
+    
+    fclose(fp);
+    
+    if (!success)
+        replayEvents.clear();
+    
+    return success;
+}
+
+void InputRecorder::stopReplay()
+{
+    replaying = false;
+    
+    replayEvents.clear();
+    replayIndex = 0;
+}
+
+bool InputRecorder::isReplaying()
+{
+    return replaying;
+}
+
+void InputRecorder::recordKey(OEComponent *canvas, OEInt usageId, bool value)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_KEY;
+    event.target = getTarget(canvas);
+    event.index = usageId;
+    event.value = value;
+    
+    record(event);
+}
+
+void InputRecorder::recordUnicodeChar(OEComponent *canvas, OEInt unicode)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_UNICODECHAR;
+    event.target = getTarget(canvas);
+    event.value = unicode;
+    
+    record(event);
+}
+
+void InputRecorder::recordMouseEnter(OEComponent *canvas)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_MOUSEENTER;
+    event.target = getTarget(canvas);
+    
+    record(event);
+}
+
+void InputRecorder::recordMouseExit(OEComponent *canvas)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_MOUSEEXIT;
+    event.target = getTarget(canvas);
+    
+    record(event);
+}
+
+void InputRecorder::recordMousePosition(OEComponent *canvas, float x, float y)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_MOUSEPOSITION;
+    event.target = getTarget(canvas);
+    event.x = x;
+    event.y = y;
+    
+    record(event);
+}
+
+void InputRecorder::recordMouseMove(OEComponent *canvas, float rx, float ry)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_MOUSEMOVE;
+    event.target = getTarget(canvas);
+    event.x = rx;
+    event.y = ry;
+    
+    record(event);
+}
+
+void InputRecorder::recordMouseButton(OEComponent *canvas, OEInt index, bool value)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_MOUSEBUTTON;
+    event.target = getTarget(canvas);
+    event.index = index;
+    event.value = value;
+    
+    record(event);
+}
+
+void InputRecorder::recordMouseWheel(OEComponent *canvas, OEInt index, float value)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_MOUSEWHEEL;
+    event.target = getTarget(canvas);
+    event.index = index;
+    event.x = value;
+    
+    record(event);
+}
+
+void InputRecorder::recordPaste(OEComponent *canvas, wstring text)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_PASTE;
+    event.target = getTarget(canvas);
+    event.text = text;
+    
+    record(event);
+}
+
+void InputRecorder::recordJoystickButton(OEInt deviceIndex, OEInt index, OEInt value)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_JOYSTICKBUTTON;
+    event.target = deviceIndex;
+    event.index = index;
+    event.value = value;
+    
+    record(event);
+}
+
+void InputRecorder::recordJoystickAxis(OEInt deviceIndex, OEInt index, float value)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_JOYSTICKAXIS;
+    event.target = deviceIndex;
+    event.index = index;
+    event.x = value;
+    
+    record(event);
+}
+
+void InputRecorder::recordJoystickHat(OEInt deviceIndex, OEInt index, OEInt value)
+{
+    if (!recordingFile)
+        return;
+    
+    InputRecorderEvent event;
+    event.type = INPUTRECORDER_JOYSTICKHAT;
+    event.target = deviceIndex;
+    event.index = index;
+    event.value = value;
+    
+    record(event);
+}
+
+void InputRecorder::notify(OEComponent *sender, int notification, void *data)
+{
+    // Called with the emulation locked, before the next step is run
+    if (!replaying || (sender != audio))
+        return;
+    
+    OELong cycles = getCycles();
+    
+    while ((replayIndex < replayEvents.size()) &&
+           (replayEvents[replayIndex].cycles <= cycles))
+        apply(replayEvents[replayIndex++]);
+    
+    if (replayIndex >= replayEvents.size())
+        replaying = false;
+}
+
+OELong InputRecorder::getCycles()
+{
+    OELong cycles = 0;
+    
+    if (!emulation)
+        return cycles;
+    
+    OEComponent *controlBus = emulation->getComponent(INPUTRECORDER_CONTROLBUS);
+    if (controlBus)
+        controlBus->postMessage(this, CONTROLBUS_GET_CYCLES, &cycles);
+    
+    return cycles;
+}
+
+OEInt InputRecorder::getTarget(OEComponent *canvas)
+{
+    for (OEInt i = 0; i < canvases.size(); i++)
+    {
+        if (canvases[i] == canvas)
+            return i;
+    }
+    
+    return INPUTRECORDER_NOTARGET;
+}
+
+void InputRecorder::record(InputRecorderEvent& event)
+{
+    OELong cycles = getCycles();
+    OELong delta = (cycles > recordingCycles) ? (cycles - recordingCycles) : 0;
+    
+    recordingCycles += delta;
+    
+    writeVarint(recordingFile, delta);
+    fputc(event.type, recordingFile);
+    fputc(event.target & 0xff, recordingFile);
+    
+    switch (event.type)
+    {
+        case INPUTRECORDER_KEY:
+        case INPUTRECORDER_MOUSEBUTTON:
+        case INPUTRECORDER_JOYSTICKBUTTON:
+        case INPUTRECORDER_JOYSTICKHAT:
+            writeVarint(recordingFile, event.index);
+            writeVarint(recordingFile, event.value);
+            
+            break;
+        
+        case INPUTRECORDER_UNICODECHAR:
+            writeVarint(recordingFile, event.value);
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEPOSITION:
+        case INPUTRECORDER_MOUSEMOVE:
+            writeFloat(recordingFile, event.x);
+            writeFloat(recordingFile, event.y);
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEWHEEL:
+        case INPUTRECORDER_JOYSTICKAXIS:
+            writeVarint(recordingFile, event.index);
+            writeFloat(recordingFile, event.x);
+            
+            break;
+        
+        case INPUTRECORDER_PASTE:
+            writeVarint(recordingFile, event.text.size());
+            
+            for (OEInt i = 0; i < event.text.size(); i++)
+                writeVarint(recordingFile, (OEUInt32) event.text[i]);
+            
+            break;
+    }
+}
+
+void InputRecorder::apply(InputRecorderEvent& event)
+{
+    // The joystick is shared by every document, so joystick events are
+    // recorded but not replayed
+    if ((event.type >= INPUTRECORDER_JOYSTICKBUTTON) &&
+        (event.type <= INPUTRECORDER_JOYSTICKHAT))
+        return;
+    
+    if (event.target >= canvases.size())
+        return;
+    
+    OpenGLCanvas *canvas = (OpenGLCanvas *)canvases[event.target];
+    if (!canvas)
+        return;
+    
+    switch (event.type)
+    {
+        case INPUTRECORDER_KEY:
+            canvas->setKey(event.index, event.value);
+            
+            break;
+        
+        case INPUTRECORDER_UNICODECHAR:
+            canvas->sendUnicodeChar((CanvasUnicodeChar) event.value);
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEENTER:
+            canvas->enterMouse();
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEEXIT:
+            canvas->exitMouse();
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEPOSITION:
+            canvas->setMousePosition(event.x, event.y);
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEMOVE:
+            canvas->moveMouse(event.x, event.y);
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEBUTTON:
+            canvas->setMouseButton(event.index, event.value);
+            
+            break;
+        
+        case INPUTRECORDER_MOUSEWHEEL:
+            canvas->sendMouseWheelEvent(event.index, event.x);
+            
+            break;
+        
+        case INPUTRECORDER_PASTE:
+            canvas->doPaste(event.text);
+            
+            break;
+    }
+}
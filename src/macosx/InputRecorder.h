@@ -0,0 +1,114 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Input Recorder
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Records and replays emulation input
+ */
+
+#ifndef _INPUTRECORDER_H
+#define _INPUTRECORDER_H
+
+#include <cstdio>
+#include <vector>
+
+#include "OEComponent.h"
+
+class OEEmulation;
+
+// Each event is stored as a varint cycle delta, a type byte, a target
+// byte and a type dependent payload of varints, floats or UTF-32 text
+#define INPUTRECORDER_SIGNATURE "OEIR"
+#define INPUTRECORDER_VERSION   1
+
+typedef enum
+{
+    INPUTRECORDER_KEY,
+    INPUTRECORDER_UNICODECHAR,
+    INPUTRECORDER_MOUSEENTER,
+    INPUTRECORDER_MOUSEEXIT,
+    INPUTRECORDER_MOUSEPOSITION,
+    INPUTRECORDER_MOUSEMOVE,
+    INPUTRECORDER_MOUSEBUTTON,
+    INPUTRECORDER_MOUSEWHEEL,
+    INPUTRECORDER_PASTE,
+    INPUTRECORDER_JOYSTICKBUTTON,
+    INPUTRECORDER_JOYSTICKAXIS,
+    INPUTRECORDER_JOYSTICKHAT,
+} InputRecorderEventType;
+
+typedef struct
+{
+    OELong cycles;
+    OEInt type;
+    OEInt target;
+    OEInt index;
+    OEInt value;
+    float x;
+    float y;
+    wstring text;
+} InputRecorderEvent;
+
+typedef vector<InputRecorderEvent> InputRecorderEvents;
+
+class InputRecorder : public OEComponent
+{
+public:
+    InputRecorder();
+    ~InputRecorder();
+    
+    void setEmulation(OEEmulation *emulation);
+    void setAudio(OEComponent *audio);
+    
+    void markOpen();
+    
+    void addCanvas(OEComponent *canvas);
+    void removeCanvas(OEComponent *canvas);
+    
+    bool startRecording(string path);
+    void stopRecording();
+    bool isRecording();
+    
+    bool loadReplay(string path);
+    void stopReplay();
+    bool isReplaying();
+    
+    void recordKey(OEComponent *canvas, OEInt usageId, bool value);
+    void recordUnicodeChar(OEComponent *canvas, OEInt unicode);
+    void recordMouseEnter(OEComponent *canvas);
+    void recordMouseExit(OEComponent *canvas);
+    void recordMousePosition(OEComponent *canvas, float x, float y);
+    void recordMouseMove(OEComponent *canvas, float rx, float ry);
+    void recordMouseButton(OEComponent *canvas, OEInt index, bool value);
+    void recordMouseWheel(OEComponent *canvas, OEInt index, float value);
+    void recordPaste(OEComponent *canvas, wstring text);
+    void recordJoystickButton(OEInt deviceIndex, OEInt index, OEInt value);
+    void recordJoystickAxis(OEInt deviceIndex, OEInt index, float value);
+    void recordJoystickHat(OEInt deviceIndex, OEInt index, OEInt value);
+    
+    void notify(OEComponent *sender, int notification, void *data);
+
+private:
+    OEEmulation *emulation;
+    OEComponent *audio;
+    OEComponents canvases;
+    
+    FILE *recordingFile;
+    OELong recordingCycles;
+    
+    OELong openCycles;
+    
+    bool replaying;
+    InputRecorderEvents replayEvents;
+    OEInt replayIndex;
+    
+    OELong getCycles();
+    OEInt getTarget(OEComponent *canvas);
+    
+    void record(InputRecorderEvent& event);
+    void apply(InputRecorderEvent& event);
+};
+
+#endif
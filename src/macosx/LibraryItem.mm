@@ -10,9 +10,8 @@
 
 #import "LibraryItem.h"
 
-#import "NSStringAdditions.h"
-
-#import "OEDocument.h"
+#import "DocumentInfoCache.h"
+#import "ImageCache.h"
 
 @implementation LibraryItem
 
@@ -56,34 +55,24 @@
     NSString *resourcePath = [[NSUserDefaults standardUserDefaults] URLForKey:@"OEDefaultResourcesPath"].path;
     
     // Read OE document
-    OEDocument oeDocument;
-    
     NSString *fullPath = [[resourcePath stringByAppendingPathComponent:@"library"]
                           stringByAppendingPathComponent:path];
     
-    oeDocument.open([fullPath cppString]);
-    if (!oeDocument.isOpen())
+    NSDictionary *info = [[DocumentInfoCache sharedCache] infoForPath:fullPath];
+    if (!info)
         return;
     
-    NSString *imagePath = [NSString stringWithCPPString:oeDocument.getHeaderInfo().image];
-    OEConnectorInfos connectorInfos = oeDocument.getFreeConnectorInfos();
-    
-    oeDocument.close();
-    
     // Read image
-    imagePath = [resourcePath stringByAppendingPathComponent:imagePath];
+    NSString *imagePath = [resourcePath stringByAppendingPathComponent:
+                           [info objectForKey:@"image"]];
     
-    image = [[NSImage alloc] initByReferencingFile:imagePath];
+    image = [[[ImageCache sharedCache] imageForPath:imagePath] retain];
     
     // Read connector type
-    if (connectorInfos.size() == 1)
-    {
-        OEConnectorInfos::iterator i = connectorInfos.begin();
-        type = [[NSString stringWithCPPString:i->type] retain];
-    }
+    type = [[info objectForKey:@"connectorType"] retain];
     
     // Read description
-    description = [[NSString stringWithCPPString:oeDocument.getHeaderInfo().description] retain];
+    description = [[info objectForKey:@"description"] retain];
 }
 
 - (NSString *)path
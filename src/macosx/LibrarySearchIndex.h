@@ -0,0 +1,26 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Library Search Index
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Indexes library entries for incremental search
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@interface LibrarySearchIndex : NSObject
+{
+    NSMutableArray *texts;
+    NSMutableDictionary *trigrams;
+}
+
+- (id)initWithTexts:(NSArray *)theTexts;
+
+- (NSUInteger)count;
+- (NSIndexSet *)search:(NSString *)query within:(NSIndexSet *)candidates;
+
++ (int)runBenchmarkWithArguments:(NSArray *)arguments;
+
+@end
@@ -0,0 +1,228 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Library Search Index
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Indexes library entries for incremental search
+ */
+
+#import "LibrarySearchIndex.h"
+
+#define LIBRARYSEARCHINDEX_BENCHMARK_ENTRYNUM   50000
+
+static NSNumber *getTrigram(unichar *c)
+{
+    return [NSNumber numberWithUnsignedLongLong:(((unsigned long long) c[0] << 32) |
+                                                 ((unsigned long long) c[1] << 16) |
+                                                 c[2])];
+}
+
+@implementation LibrarySearchIndex
+
+- (id)initWithTexts:(NSArray *)theTexts
+{
+    self = [super init];
+    
+    if (self)
+    {
+        texts = [[NSMutableArray alloc] initWithCapacity:[theTexts count]];
+        trigrams = [[NSMutableDictionary alloc] init];
+        
+        for (NSUInteger i = 0; i < [theTexts count]; i++)
+        {
+            NSString *text = [[theTexts objectAtIndex:i] lowercaseString];
+            [texts addObject:text];
+            
+            NSUInteger length = [text length];
+            if (length < 3)
+                continue;
+            
+            unichar *characters = malloc(length * sizeof(unichar));
+            [text getCharacters:characters range:NSMakeRange(0, length)];
+            
+            for (NSUInteger j = 0; j + 2 < length; j++)
+            {
+                NSNumber *trigram = getTrigram(characters + j);
+                
+                NSMutableIndexSet *postings = [trigrams objectForKey:trigram];
+                if (!postings)
+                {
+                    postings = [NSMutableIndexSet indexSet];
+                    [trigrams setObject:postings forKey:trigram];
+                }
+                
+                [postings addIndex:i];
+            }
+            
+            free(characters);
+        }
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [texts release];
+    [trigrams release];
+    
+    [super dealloc];
+}
+
+- (NSUInteger)count
+{
+    return [texts count];
+}
+
+// Candidates from a previous, shorter query narrow the search. Otherwise
+// the postings of every trigram in the query are intersected.
+- (NSIndexSet *)search:(NSString *)query within:(NSIndexSet *)candidates
+{
+    query = [query lowercaseString];
+    
+    NSUInteger length = [query length];
+    
+    if (!candidates)
+    {
+        if (length < 3)
+            candidates = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, [texts count])];
+        else
+        {
+            unichar *characters = malloc(length * sizeof(unichar));
+            [query getCharacters:characters range:NSMakeRange(0, length)];
+            
+            NSMutableIndexSet *intersection = nil;
+            for (NSUInteger j = 0; j + 2 < length; j++)
+            {
+                NSIndexSet *postings = [trigrams objectForKey:getTrigram(characters + j)];
+                if (!postings)
+                {
+                    intersection = [NSMutableIndexSet indexSet];
+                    
+                    break;
+                }
+                
+                if (!intersection)
+                    intersection = [[postings mutableCopy] autorelease];
+                else
+                {
+                    NSMutableIndexSet *missing = [[intersection mutableCopy] autorelease];
+                    [missing removeIndexes:postings];
+                    [intersection removeIndexes:missing];
+                }
+                
+                if (![intersection count])
+                    break;
+            }
+            
+            free(characters);
+            
+            candidates = intersection;
+        }
+    }
+    
+    // Trigrams may match out of order, so every candidate is verified
+    NSMutableIndexSet *result = [NSMutableIndexSet indexSet];
+    NSUInteger i = [candidates firstIndex];
+    while (i != NSNotFound)
+    {
+        if ([[texts objectAtIndex:i] rangeOfString:query
+                                           options:NSLiteralSearch].location != NSNotFound)
+            [result addIndex:i];
+        
+        i = [candidates indexGreaterThanIndex:i];
+    }
+    
+    return result;
+}
+
++ (int)runBenchmarkWithArguments:(NSArray *)arguments
+{
+    NSUInteger entryNum = LIBRARYSEARCHINDEX_BENCHMARK_ENTRYNUM;
+    if ([arguments count])
+        entryNum = [[arguments objectAtIndex:0] integerValue];
+    
+    NSArray *vendors = [NSArray arrayWithObjects:
+                        @"Apple", @"Videx", @"Achatz", @"Briel", @"Signetics", @"R&D",
+                        nil];
+    NSArray *kinds = [NSArray arrayWithObjects:
+                      @"Disk II Interface Card", @"Language Card", @"Videoterm",
+                      @"Super Serial Card", @"Mouse Interface Card", @"Monitor",
+                      @"Joystick", @"Printer", @"Cassette Recorder",
+                      nil];
+    
+    // Synthetic library of paths, labels and connector types
+    srandom(1);
+    
+    NSMutableArray *theTexts = [NSMutableArray arrayWithCapacity:entryNum];
+    for (NSUInteger i = 0; i < entryNum; i++)
+    {
+        NSString *vendor = [vendors objectAtIndex:random() % [vendors count]];
+        NSString *kind = [kinds objectAtIndex:random() % [kinds count]];
+        
+        [theTexts addObject:[NSString stringWithFormat:@"%@/%@ %lu.xml\n%@ %lu\nApple II Slot\n"
+                             "A %@ expansion made by %@",
+                             vendor, kind, (unsigned long) i,
+                             kind, (unsigned long) i,
+                             kind, vendor]];
+    }
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
+    LibrarySearchIndex *index = [[[LibrarySearchIndex alloc] initWithTexts:theTexts]
+                                 autorelease];
+    
+    printf("%lu entries indexed in %.3f s\n",
+           (unsigned long) entryNum, CFAbsoluteTimeGetCurrent() - startTime);
+    
+    // Type a query one key at a time, as in the search field
+    NSString *query = @"videoterm 12";
+    NSIndexSet *previousResult = nil;
+    double scanTime = 0;
+    double indexTime = 0;
+    
+    for (NSUInteger i = 1; i <= [query length]; i++)
+    {
+        NSString *prefix = [query substringToIndex:i];
+        
+        startTime = CFAbsoluteTimeGetCurrent();
+        
+        NSUInteger scanNum = 0;
+        for (NSString *text in theTexts)
+        {
+            if ([text rangeOfString:prefix
+                            options:NSCaseInsensitiveSearch].location != NSNotFound)
+                scanNum++;
+        }
+        
+        CFAbsoluteTime scannedTime = CFAbsoluteTimeGetCurrent();
+        
+        previousResult = [index search:prefix within:previousResult];
+        
+        CFAbsoluteTime searchedTime = CFAbsoluteTimeGetCurrent();
+        
+        scanTime += scannedTime - startTime;
+        indexTime += searchedTime - scannedTime;
+        
+        printf("\"%s\": %lu matches, scan %.2f ms, index %.2f ms\n",
+               [prefix UTF8String],
+               (unsigned long) [previousResult count],
+               (scannedTime - startTime) * 1000,
+               (searchedTime - scannedTime) * 1000);
+        
+        if (scanNum != [previousResult count])
+        {
+            fprintf(stderr, "result mismatch: scan found %lu\n", (unsigned long) scanNum);
+            
+            return 1;
+        }
+    }
+    
+    printf("total: scan %.2f ms, index %.2f ms\n", scanTime * 1000, indexTime * 1000);
+    
+    return 0;
+}
+
+@end
@@ -11,6 +11,7 @@
 #import <Cocoa/Cocoa.h>
 
 #import "LibraryTableCell.h"
+#import "LibrarySearchIndex.h"
 
 @interface LibraryWindowController : NSWindowController
 <NSTableViewDataSource, NSTableViewDelegate>
@@ -26,6 +27,10 @@
     NSMutableArray *filteredItems;
     LibraryTableCell *cell;
     
+    LibrarySearchIndex *searchIndex;
+    NSString *lastSearchString;
+    NSIndexSet *lastSearchResult;
+    
     IBOutlet id fSelImage;
     IBOutlet id fSelLabel;
     IBOutlet id fSelType;
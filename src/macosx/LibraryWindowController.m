@@ -31,6 +31,10 @@
     
     [cell release];
     
+    [searchIndex release];
+    [lastSearchString release];
+    [lastSearchResult release];
+    
     [super dealloc];
 }
 
@@ -87,39 +91,66 @@
     [self filterItems:self];
 }
 
+// Labels, types and descriptions come from the documents, so the index
+// is only built when the library is first searched
+- (void)buildSearchIndex
+{
+    NSMutableArray *texts = [NSMutableArray arrayWithCapacity:[items count]];
+    for (LibraryItem *item in items)
+        [texts addObject:[NSString stringWithFormat:@"%@\n%@\n%@\n%@",
+                          [item path],
+                          [item label],
+                          [item type] ? [item type] : @"",
+                          [item description] ? [item description] : @""]];
+    
+    searchIndex = [[LibrarySearchIndex alloc] initWithTexts:texts];
+}
+
 - (IBAction)filterItems:(id)sender
 {
     NSString *filterPath = [filterPaths objectAtIndex:
                             [fPathFilter indexOfSelectedItem]];
     if ([filterPath length])
         filterPath = [filterPath stringByAppendingString:@"/"];
-    int filterPathLength = (int) [filterPath length];
     
     NSString *searchString = [fSearchFilter stringValue];
     
     [filteredItems removeAllObjects];
     
-    for (int i = 0; i < [items count]; i++)
+    // Validate search condition
+    NSIndexSet *searchResult;
+    if ([searchString length])
+    {
+        if (!searchIndex)
+            [self buildSearchIndex];
+        
+        // A query that extends the last one can only narrow its result
+        NSIndexSet *candidates = nil;
+        if (lastSearchString &&
+            ([searchString rangeOfString:lastSearchString
+                                 options:NSCaseInsensitiveSearch].location != NSNotFound))
+            candidates = lastSearchResult;
+        
+        searchResult = [searchIndex search:searchString within:candidates];
+    }
+    else
+        searchResult = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, [items count])];
+    
+    [lastSearchString release];
+    lastSearchString = [searchString length] ? [searchString copy] : nil;
+    [lastSearchResult release];
+    lastSearchResult = [searchString length] ? [searchResult retain] : nil;
+    
+    NSUInteger i = [searchResult firstIndex];
+    while (i != NSNotFound)
     {
         LibraryItem *item = [items objectAtIndex:i];
         
         // Validate path condition
-        if ([[[item path] substringToIndex:filterPathLength] compare:
-            filterPath] != NSOrderedSame)
-            continue;
-        
-        // Validate search condition
-        if ([searchString length])
-        {
-            NSRange range;
-            
-            range = [[item path] rangeOfString:searchString
-                                       options:NSCaseInsensitiveSearch];
-            if (range.location == NSNotFound)
-                continue;
-        }
+        if ([[item path] hasPrefix:filterPath])
+            [filteredItems addObject:item];
         
-        [filteredItems addObject:item];
+        i = [searchResult indexGreaterThanIndex:i];
     }
     
     [fTableView reloadData];
@@ -0,0 +1,36 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Mount Operation
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Prepares a disk image for mounting in the background
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define MOUNTOPERATION_CHUNKSIZE    (1024 * 1024)
+#define MOUNTOPERATION_WHOLESIZE    (32 * 1024 * 1024)
+
+@interface MountOperation : NSOperation
+{
+    NSString *path;
+    id context;
+    id target;
+    SEL action;
+    
+    unsigned long long readSize;
+    volatile unsigned long long preparedSize;
+}
+
+- (id)initWithPath:(NSString *)thePath
+           context:(id)theContext
+            target:(id)theTarget
+            action:(SEL)theAction;
+
+- (NSString *)path;
+- (id)context;
+- (double)progress;
+
+@end
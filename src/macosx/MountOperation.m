@@ -0,0 +1,121 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Mount Operation
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Prepares a disk image for mounting in the background
+ */
+
+#import "MountOperation.h"
+
+@implementation MountOperation
+
+- (id)initWithPath:(NSString *)thePath
+           context:(id)theContext
+            target:(id)theTarget
+            action:(SEL)theAction
+{
+    self = [super init];
+    
+    if (self)
+    {
+        path = [thePath copy];
+        context = [theContext retain];
+        target = [theTarget retain];
+        action = theAction;
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [path release];
+    [context release];
+    [target release];
+    
+    [super dealloc];
+}
+
+- (NSString *)path
+{
+    return path;
+}
+
+- (id)context
+{
+    return context;
+}
+
+- (double)progress
+{
+    if (!readSize)
+        return 0;
+    
+    return (double) preparedSize / readSize;
+}
+
+- (void)readFile:(int)fd from:(off_t)offset size:(unsigned long long)size
+{
+    char *buffer = malloc(MOUNTOPERATION_CHUNKSIZE);
+    
+    while (![self isCancelled] && size)
+    {
+        size_t chunkSize = (size_t) MIN(size, MOUNTOPERATION_CHUNKSIZE);
+        ssize_t n = pread(fd, buffer, chunkSize, offset);
+        if (n <= 0)
+            break;
+        
+        offset += n;
+        size -= n;
+        preparedSize += n;
+    }
+    
+    free(buffer);
+}
+
+// Reads the image outside the emulation lock, so the storage component
+// loads it from the page cache while the emulation is locked. Only images
+// up to MOUNTOPERATION_WHOLESIZE are read, as they are loaded whole. Larger
+// images are read on demand by the storage component, so reading them here
+// would not shorten the lock; they are passed on right away.
+- (void)main
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    NSDictionary *attributes = [[NSFileManager defaultManager]
+                                attributesOfItemAtPath:path error:nil];
+    
+    unsigned long long fileSize = [attributes fileSize];
+    
+    if ([[attributes fileType] isEqualToString:NSFileTypeRegular] &&
+        (fileSize <= MOUNTOPERATION_WHOLESIZE))
+    {
+        int fd = open([path fileSystemRepresentation], O_RDONLY);
+        if (fd >= 0)
+        {
+            readSize = fileSize;
+            
+            [self readFile:fd from:0 size:fileSize];
+            
+            close(fd);
+        }
+    }
+    
+    if ([self isCancelled])
+    {
+        [pool drain];
+        
+        return;
+    }
+    
+    [target performSelectorOnMainThread:action
+                             withObject:self
+                          waitUntilDone:NO];
+    
+    [pool drain];
+}
+
+@end
@@ -0,0 +1,34 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Mount Progress Controller
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shows the progress of a mount operation
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#import "MountOperation.h"
+
+#define MOUNTPROGRESS_DELAY     0.5
+#define MOUNTPROGRESS_INTERVAL  0.1
+
+@interface MountProgressController : NSWindowController
+{
+    MountOperation *operation;
+    NSWindow *parentWindow;
+    
+    NSProgressIndicator *progressIndicator;
+    NSTimer *timer;
+    CFAbsoluteTime startTime;
+    BOOL sheetShown;
+}
+
+- (id)initWithOperation:(MountOperation *)theOperation
+                 window:(NSWindow *)theWindow;
+
+- (IBAction)cancel:(id)sender;
+
+@end
@@ -0,0 +1,123 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Mount Progress Controller
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shows the progress of a mount operation
+ */
+
+#import "MountProgressController.h"
+
+@implementation MountProgressController
+
+- (id)initWithOperation:(MountOperation *)theOperation
+                 window:(NSWindow *)theWindow
+{
+    NSPanel *panel = [[[NSPanel alloc] initWithContentRect:NSMakeRect(0, 0, 360, 100)
+                                                 styleMask:NSTitledWindowMask
+                                                   backing:NSBackingStoreBuffered
+                                                     defer:YES] autorelease];
+    
+    self = [super initWithWindow:panel];
+    
+    if (self)
+    {
+        operation = [theOperation retain];
+        parentWindow = [theWindow retain];
+        
+        NSView *contentView = [panel contentView];
+        
+        NSTextField *label = [[[NSTextField alloc] initWithFrame:
+                               NSMakeRect(20, 62, 320, 18)] autorelease];
+        [label setStringValue:[NSString localizedStringWithFormat:
+                               @"Preparing \u201C%@\u201D\u2026",
+                               [[operation path] lastPathComponent]]];
+        [label setEditable:NO];
+        [label setBordered:NO];
+        [label setDrawsBackground:NO];
+        [[label cell] setLineBreakMode:NSLineBreakByTruncatingMiddle];
+        [contentView addSubview:label];
+        
+        progressIndicator = [[NSProgressIndicator alloc] initWithFrame:
+                             NSMakeRect(20, 40, 320, 20)];
+        [progressIndicator setIndeterminate:NO];
+        [progressIndicator setMinValue:0];
+        [progressIndicator setMaxValue:1];
+        [contentView addSubview:progressIndicator];
+        
+        NSButton *button = [[[NSButton alloc] initWithFrame:
+                             NSMakeRect(250, 8, 96, 32)] autorelease];
+        [button setBezelStyle:NSRoundedBezelStyle];
+        [button setTitle:NSLocalizedString(@"Cancel", @"Mount Progress")];
+        [button setKeyEquivalent:@"\e"];
+        [button setTarget:self];
+        [button setAction:@selector(cancel:)];
+        [contentView addSubview:button];
+        
+        startTime = CFAbsoluteTimeGetCurrent();
+        
+        // The timer keeps this controller alive until the operation ends
+        timer = [NSTimer scheduledTimerWithTimeInterval:MOUNTPROGRESS_INTERVAL
+                                                 target:self
+                                               selector:@selector(update:)
+                                               userInfo:nil
+                                                repeats:YES];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [operation release];
+    [parentWindow release];
+    
+    [progressIndicator release];
+    
+    [super dealloc];
+}
+
+- (void)update:(NSTimer *)theTimer
+{
+    if ([operation isFinished] || [operation isCancelled])
+    {
+        if (sheetShown)
+        {
+            [NSApp endSheet:[self window]];
+            [[self window] orderOut:self];
+        }
+        
+        [timer invalidate];
+        timer = nil;
+        
+        return;
+    }
+    
+    // Small images are prepared before the sheet would be noticed
+    if (!sheetShown &&
+        parentWindow &&
+        ![parentWindow attachedSheet] &&
+        ((CFAbsoluteTimeGetCurrent() - startTime) > MOUNTPROGRESS_DELAY))
+    {
+        [NSApp beginSheet:[self window]
+           modalForWindow:parentWindow
+            modalDelegate:nil
+           didEndSelector:nil
+              contextInfo:nil];
+        
+        sheetShown = YES;
+    }
+    
+    [progressIndicator setDoubleValue:[operation progress]];
+}
+
+- (IBAction)cancel:(id)sender
+{
+    [operation cancel];
+    
+    [self update:timer];
+}
+
+@end
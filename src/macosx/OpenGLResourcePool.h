@@ -0,0 +1,22 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X OpenGL Resource Pool
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shares the OpenGL pixel format between canvas views
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@interface OpenGLResourcePool : NSObject
+{
+    NSOpenGLPixelFormat *pixelFormat;
+}
+
++ (OpenGLResourcePool *)sharedPool;
+
+- (NSOpenGLPixelFormat *)pixelFormat;
+
+@end
@@ -0,0 +1,60 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X OpenGL Resource Pool
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shares the OpenGL pixel format between canvas views
+ */
+
+#import "OpenGLResourcePool.h"
+
+@implementation OpenGLResourcePool
+
+static OpenGLResourcePool *sharedPool = nil;
+
++ (OpenGLResourcePool *)sharedPool
+{
+    @synchronized(self)
+    {
+        if (!sharedPool)
+            sharedPool = [[OpenGLResourcePool alloc] init];
+    }
+    
+    return sharedPool;
+}
+
+- (void)dealloc
+{
+    [pixelFormat release];
+    
+    [super dealloc];
+}
+
+- (NSOpenGLPixelFormat *)pixelFormat
+{
+    @synchronized(self)
+    {
+        if (!pixelFormat)
+        {
+            NSOpenGLPixelFormatAttribute pixelFormatAtrributes[] =
+            {
+                NSOpenGLPFADoubleBuffer,
+                NSOpenGLPFADepthSize,
+                32,
+                0
+            };
+            
+            pixelFormat = [[NSOpenGLPixelFormat alloc]
+                           initWithAttributes:pixelFormatAtrributes];
+            
+            if (!pixelFormat)
+                NSLog(@"Cannot create NSOpenGLPixelFormat");
+        }
+    }
+    
+    return pixelFormat;
+}
+
+@end
@@ -0,0 +1,30 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Package Blob Store
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shares identical package files through a content-addressed store
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define PACKAGEBLOBSTORE_FOLDER     @"~/Library/Application Support/OpenEmulator/Blobs"
+#define PACKAGEBLOBSTORE_INDEX      @"index.plist"
+#define PACKAGEBLOBSTORE_MINSIZE    65536
+
+@interface PackageBlobStore : NSObject
+{
+    NSString *storePath;
+    NSOperationQueue *queue;
+    NSMutableDictionary *index;
+}
+
++ (PackageBlobStore *)sharedStore;
++ (BOOL)isCloneAvailable;
+
+- (void)deduplicatePackage:(NSString *)packagePath;
+- (void)collectBlobs;
+
+@end
@@ -0,0 +1,328 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Package Blob Store
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Shares identical package files through a content-addressed store
+ */
+
+#import <CommonCrypto/CommonDigest.h>
+#import <sys/clonefile.h>
+
+#import "PackageBlobStore.h"
+
+#import "Document.h"
+
+static NSString *getSHA256(NSString *path)
+{
+    NSData *data = [NSData dataWithContentsOfFile:path
+                                          options:NSDataReadingMappedIfSafe
+                                            error:nil];
+    if (!data)
+        return nil;
+    
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256([data bytes], (CC_LONG) [data length], digest);
+    
+    NSMutableString *hash = [NSMutableString string];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++)
+        [hash appendFormat:@"%02x", digest[i]];
+    
+    return hash;
+}
+
+// clonefile() is weakly linked, as it first appeared in Mac OS X 10.12
+static BOOL isCloneAvailable()
+{
+    return (&clonefile != NULL);
+}
+
+static BOOL cloneFile(NSString *fromPath, NSString *toPath)
+{
+    if (!isCloneAvailable())
+        return NO;
+    
+    return (clonefile([fromPath fileSystemRepresentation],
+                      [toPath fileSystemRepresentation],
+                      0) == 0);
+}
+
+static NSNumber *getFileDate(NSDictionary *attributes)
+{
+    return [NSNumber numberWithDouble:[[attributes fileModificationDate]
+                                       timeIntervalSinceReferenceDate]];
+}
+
+// Whether a file still has the size and date it had when it was cloned
+static BOOL isEntryCurrent(NSDictionary *entry, NSDictionary *attributes)
+{
+    return (entry && attributes &&
+            ([[entry objectForKey:@"size"] unsignedLongLongValue] == [attributes fileSize]) &&
+            [[entry objectForKey:@"date"] isEqualToNumber:getFileDate(attributes)]);
+}
+
+@implementation PackageBlobStore
+
++ (PackageBlobStore *)sharedStore
+{
+    static PackageBlobStore *sharedStore = nil;
+    
+    @synchronized(self)
+    {
+        if (!sharedStore)
+            sharedStore = [[PackageBlobStore alloc] init];
+    }
+    
+    return sharedStore;
+}
+
++ (BOOL)isCloneAvailable
+{
+    return isCloneAvailable();
+}
+
+- (id)init
+{
+    self = [super init];
+    
+    if (self)
+    {
+        storePath = [[PACKAGEBLOBSTORE_FOLDER stringByExpandingTildeInPath] retain];
+        
+        // Hashing and cloning run in the background, one package at a time
+        queue = [[NSOperationQueue alloc] init];
+        [queue setMaxConcurrentOperationCount:1];
+        
+        // Package file path -> hash and the stamp of the file when it was cloned
+        index = [[NSMutableDictionary alloc] initWithContentsOfFile:
+                 [storePath stringByAppendingPathComponent:PACKAGEBLOBSTORE_INDEX]];
+        if (!index)
+            index = [[NSMutableDictionary alloc] init];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [storePath release];
+    [queue release];
+    [index release];
+    
+    [super dealloc];
+}
+
+- (NSString *)blobPathForHash:(NSString *)hash
+{
+    return [[storePath stringByAppendingPathComponent:[hash substringToIndex:2]]
+            stringByAppendingPathComponent:hash];
+}
+
+- (void)saveIndex
+{
+    [index writeToFile:[storePath stringByAppendingPathComponent:PACKAGEBLOBSTORE_INDEX]
+            atomically:YES];
+}
+
+- (NSDictionary *)entryForHash:(NSString *)hash attributes:(NSDictionary *)attributes
+{
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            hash, @"hash",
+            [NSNumber numberWithUnsignedLongLong:[attributes fileSize]], @"size",
+            getFileDate(attributes), @"date",
+            nil];
+}
+
+// Whether a document runs from the package, or has it as its file. Checked
+// on the main thread, where documents are opened and closed.
+- (BOOL)isPackageOpen:(NSString *)packagePath
+{
+    if (![NSThread isMainThread])
+    {
+        __block BOOL value;
+        
+        dispatch_sync(dispatch_get_main_queue(), ^{
+            value = [self isPackageOpen:packagePath];
+        });
+        
+        return value;
+    }
+    
+    packagePath = [packagePath stringByStandardizingPath];
+    
+    for (Document *document in [[NSDocumentController sharedDocumentController] documents])
+    {
+        if (![document isKindOfClass:[Document class]])
+            continue;
+        
+        if ([[[document emulationPath] stringByStandardizingPath] isEqualToString:packagePath] ||
+            [[[[document fileURL] path] stringByStandardizingPath] isEqualToString:packagePath])
+            return YES;
+    }
+    
+    return NO;
+}
+
+// Replaces path with a clone of the blob holding the same content.
+// Clones share their blocks until either copy is written. The file is
+// left alone if it changed since it was enumerated, or its package was
+// opened meanwhile.
+- (BOOL)deduplicateFile:(NSString *)path
+             attributes:(NSDictionary *)attributes
+                package:(NSString *)packagePath
+{
+    NSString *hash = getSHA256(path);
+    if (!hash)
+        return NO;
+    
+    NSString *blobPath = [self blobPathForHash:hash];
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    
+    BOOL isShared = NO;
+    if (![fileManager fileExistsAtPath:blobPath])
+    {
+        [fileManager createDirectoryAtPath:[blobPath stringByDeletingLastPathComponent]
+               withIntermediateDirectories:YES
+                                attributes:nil
+                                     error:nil];
+        
+        // The first copy becomes the blob, and is kept as it is
+        if (!cloneFile(path, blobPath))
+            return NO;
+        
+        // A file written while it was hashed would give a blob whose
+        // content does not match its name
+        if (!isEntryCurrent([self entryForHash:hash attributes:attributes],
+                            [fileManager attributesOfItemAtPath:path error:nil]))
+        {
+            [fileManager removeItemAtPath:blobPath error:nil];
+            
+            return NO;
+        }
+    }
+    else
+    {
+        NSString *tempPath = [path stringByAppendingString:@".oeblob"];
+        if (!cloneFile(blobPath, tempPath))
+            return NO;
+        
+        // Checked last, right before the file is replaced
+        if (!isEntryCurrent([self entryForHash:hash attributes:attributes],
+                            [fileManager attributesOfItemAtPath:path error:nil]) ||
+            [self isPackageOpen:packagePath] ||
+            (rename([tempPath fileSystemRepresentation],
+                    [path fileSystemRepresentation]) != 0))
+        {
+            unlink([tempPath fileSystemRepresentation]);
+            
+            return NO;
+        }
+        
+        isShared = YES;
+    }
+    
+    attributes = [fileManager attributesOfItemAtPath:path error:nil];
+    [index setObject:[self entryForHash:hash attributes:attributes]
+              forKey:path];
+    
+    return isShared;
+}
+
+// A blob is deleted once no package file still holds its content: the file
+// was deleted, or was written after it was cloned
+- (void)collectBlobsNow
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSMutableSet *hashes = [NSMutableSet set];
+    
+    for (NSString *path in [index allKeys])
+    {
+        NSDictionary *entry = [index objectForKey:path];
+        NSDictionary *attributes = [fileManager attributesOfItemAtPath:path error:nil];
+        
+        if (isEntryCurrent(entry, attributes))
+            [hashes addObject:[entry objectForKey:@"hash"]];
+        else
+            [index removeObjectForKey:path];
+    }
+    
+    for (NSString *group in [fileManager contentsOfDirectoryAtPath:storePath error:nil])
+    {
+        NSString *groupPath = [storePath stringByAppendingPathComponent:group];
+        
+        for (NSString *hash in [fileManager contentsOfDirectoryAtPath:groupPath error:nil])
+        {
+            if ([hashes containsObject:hash])
+                continue;
+            
+            [fileManager removeItemAtPath:[groupPath stringByAppendingPathComponent:hash]
+                                    error:nil];
+        }
+    }
+    
+    [self saveIndex];
+}
+
+// Packages that are open are skipped, as their files may be open or written
+- (void)deduplicatePackageNow:(NSString *)packagePath
+{
+    if ([self isPackageOpen:packagePath])
+        return;
+    
+    NSDirectoryEnumerator *enumerator;
+    enumerator = [[NSFileManager defaultManager] enumeratorAtPath:packagePath];
+    
+    NSString *subpath;
+    while ((subpath = [enumerator nextObject]))
+    {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        
+        NSDictionary *attributes = [enumerator fileAttributes];
+        NSString *path = [packagePath stringByAppendingPathComponent:subpath];
+        
+        // Small files such as info.xml are not worth sharing, and files
+        // unchanged since they were last cloned are not hashed again
+        if (![[attributes fileType] isEqualToString:NSFileTypeRegular] ||
+            ([attributes fileSize] < PACKAGEBLOBSTORE_MINSIZE) ||
+            isEntryCurrent([index objectForKey:path], attributes))
+        {
+            [pool drain];
+            
+            continue;
+        }
+        
+        [self deduplicateFile:path
+                   attributes:attributes
+                      package:packagePath];
+        
+        [pool drain];
+    }
+    
+    [self collectBlobsNow];
+}
+
+- (void)deduplicatePackage:(NSString *)packagePath
+{
+    if (!isCloneAvailable())
+        return;
+    
+    [queue addOperation:[[[NSInvocationOperation alloc]
+                          initWithTarget:self
+                          selector:@selector(deduplicatePackageNow:)
+                          object:[[packagePath copy] autorelease]] autorelease]];
+}
+
+- (void)collectBlobs
+{
+    if (!isCloneAvailable())
+        return;
+    
+    [queue addOperation:[[[NSInvocationOperation alloc]
+                          initWithTarget:self
+                          selector:@selector(collectBlobsNow)
+                          object:nil] autorelease]];
+}
+
+@end
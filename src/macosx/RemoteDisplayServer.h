@@ -0,0 +1,61 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Remote Display Server
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Serves canvas frames and input over the RFB protocol
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#import "Document.h"
+
+#define REMOTEDISPLAY_BASEPORT          5900
+#define REMOTEDISPLAY_PORTNUM           64
+#define REMOTEDISPLAY_MAXFRAMERATE      30
+#define REMOTEDISPLAY_MAXBANDWIDTH      (4 * 1024 * 1024)
+
+@interface RemoteDisplayServer : NSObject
+{
+    Document *document;
+    void *canvas;
+    NSString *name;
+    
+    int listenSocket;
+    int port;
+    double maxFrameRate;
+    double maxBandwidth;
+    
+    NSCondition *frameCondition;
+    unsigned char *framePixels;
+    unsigned char *capturePixels;
+    int frameWidth;
+    int frameHeight;
+    long long frameSequence;
+    double captureTime;
+    
+    volatile int32_t clientNum;
+    volatile BOOL stopRequested;
+    volatile BOOL frameRequested;
+    
+    volatile int64_t sentFrameNum;
+    volatile int64_t sentByteNum;
+}
+
+- (id)initWithDocument:(Document *)theDocument
+                canvas:(void *)theCanvas
+                  name:(NSString *)theName;
+
+- (BOOL)open;
+- (void)captureFrame;
+- (void)close;
+
+- (int)port;
+- (NSInteger)clientNum;
+- (BOOL)isFrameRequested;
+- (long long)sentFrameNum;
+- (long long)sentByteNum;
+
+@end
@@ -0,0 +1,1327 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Remote Display Server
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Serves canvas frames and input over the RFB protocol
+ */
+
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <netinet/tcp.h>
+#import <arpa/inet.h>
+#import <libkern/OSAtomic.h>
+#import <OpenGL/gl.h>
+#import <zlib.h>
+
+#import <set>
+#import <vector>
+
+#import "RemoteDisplayServer.h"
+
+#import "NSStringAdditions.h"
+
+#import "InputRecorder.h"
+
+#import "OpenGLCanvas.h"
+
+#define RFB_ENCODING_RAW            0
+#define RFB_ENCODING_ZRLE           16
+#define RFB_ENCODING_DESKTOPSIZE    -223
+
+#define RFB_CUTTEXT_MAXSIZE         (1024 * 1024)
+
+#define ZRLE_TILESIZE               64
+#define ZRLE_PALETTE_MAXSIZE        16
+
+using namespace std;
+
+typedef struct
+{
+    int bitsPerPixel;
+    int depth;
+    bool bigEndian;
+    bool trueColour;
+    int redMax;
+    int greenMax;
+    int blueMax;
+    int redShift;
+    int greenShift;
+    int blueShift;
+    
+    // ZRLE drops the unused byte of 32 bit pixels
+    int cpixelSize;
+    int cpixelShift;
+} RFBPixelFormat;
+
+typedef struct
+{
+    int x;
+    int y;
+    int width;
+    int height;
+} RFBRect;
+
+typedef struct
+{
+    int socket;
+    RFBPixelFormat format;
+    bool zrle;
+    bool desktopSize;
+    z_stream zstream;
+    
+    bool updateRequested;
+    bool fullUpdateRequested;
+    bool closed;
+    bool encoderDone;
+    
+    int width;
+    int height;
+    vector<unsigned char> pixels;
+    vector<unsigned char> lastPixels;
+    int lastWidth;
+    int lastHeight;
+    long long lastSequence;
+    
+    double updateTime;
+    double bandwidthCredit;
+    double bandwidthTime;
+    
+    int buttonMask;
+    int pointerX;
+    int pointerY;
+    bool pointerEntered;
+    set<int> keysDown;
+} RemoteDisplayClient;
+
+static void setPixelFormat(RFBPixelFormat& format, const unsigned char *data)
+{
+    format.bitsPerPixel = data[0];
+    format.depth = data[1];
+    format.bigEndian = data[2];
+    format.trueColour = data[3];
+    format.redMax = (data[4] << 8) | data[5];
+    format.greenMax = (data[6] << 8) | data[7];
+    format.blueMax = (data[8] << 8) | data[9];
+    format.redShift = data[10];
+    format.greenShift = data[11];
+    format.blueShift = data[12];
+    
+    unsigned int mask = ((format.redMax << format.redShift) |
+                         (format.greenMax << format.greenShift) |
+                         (format.blueMax << format.blueShift));
+    
+    format.cpixelSize = format.bitsPerPixel / 8;
+    format.cpixelShift = 0;
+    if ((format.bitsPerPixel == 32) && (format.depth <= 24))
+    {
+        if (!(mask & 0xff000000))
+            format.cpixelSize = 3;
+        else if (!(mask & 0xff))
+        {
+            format.cpixelSize = 3;
+            format.cpixelShift = 8;
+        }
+    }
+}
+
+static void putU8(vector<unsigned char>& data, unsigned int value)
+{
+    data.push_back(value);
+}
+
+static void putU16(vector<unsigned char>& data, unsigned int value)
+{
+    data.push_back(value >> 8);
+    data.push_back(value);
+}
+
+static void putU32(vector<unsigned char>& data, unsigned int value)
+{
+    data.push_back(value >> 24);
+    data.push_back(value >> 16);
+    data.push_back(value >> 8);
+    data.push_back(value);
+}
+
+static void putPixel(vector<unsigned char>& data, const RFBPixelFormat& format,
+                     int size, const unsigned char *rgba)
+{
+    unsigned int value = (((rgba[0] * format.redMax / 255) << format.redShift) |
+                          ((rgba[1] * format.greenMax / 255) << format.greenShift) |
+                          ((rgba[2] * format.blueMax / 255) << format.blueShift));
+    
+    if (size < format.bitsPerPixel / 8)
+        value >>= format.cpixelShift;
+    
+    if (format.bigEndian)
+        for (int i = size - 1; i >= 0; i--)
+            data.push_back(value >> (8 * i));
+    else
+        for (int i = 0; i < size; i++)
+            data.push_back(value >> (8 * i));
+}
+
+static bool readAll(int fd, void *buffer, size_t size)
+{
+    unsigned char *p = (unsigned char *)buffer;
+    
+    while (size)
+    {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n <= 0)
+            return false;
+        
+        p += n;
+        size -= n;
+    }
+    
+    return true;
+}
+
+static bool sendAll(int fd, const void *buffer, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)buffer;
+    
+    while (size)
+    {
+        ssize_t n = send(fd, p, size, 0);
+        if (n <= 0)
+            return false;
+        
+        p += n;
+        size -= n;
+    }
+    
+    return true;
+}
+
+// Palette tiles suit the few colors of emulated displays; run-length and
+// raw tiles catch the rest, whichever is smaller
+static void encodeZRLETile(vector<unsigned char>& data, const RFBPixelFormat& format,
+                           const unsigned char *pixels, int stride,
+                           int width, int height)
+{
+    unsigned int palette[ZRLE_PALETTE_MAXSIZE];
+    int paletteSize = 0;
+    int runNum = 0;
+    unsigned int lastValue = 0;
+    
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned int *row = (const unsigned int *)(pixels + y * stride);
+        
+        for (int x = 0; x < width; x++)
+        {
+            unsigned int value = row[x] | 0xff000000;
+            
+            if (!runNum || (value != lastValue))
+            {
+                runNum++;
+                lastValue = value;
+            }
+            
+            if (paletteSize > ZRLE_PALETTE_MAXSIZE)
+                continue;
+            
+            int i;
+            for (i = 0; i < paletteSize; i++)
+                if (palette[i] == value)
+                    break;
+            
+            if (i == paletteSize)
+            {
+                if (paletteSize < ZRLE_PALETTE_MAXSIZE)
+                    palette[i] = value;
+                paletteSize++;
+            }
+        }
+    }
+    
+    int cpixelSize = format.cpixelSize;
+    
+    if (paletteSize == 1)
+    {
+        putU8(data, 1);
+        putPixel(data, format, cpixelSize, (const unsigned char *)&palette[0]);
+        
+        return;
+    }
+    
+    if (paletteSize <= ZRLE_PALETTE_MAXSIZE)
+    {
+        int bitNum = (paletteSize == 2) ? 1 : (paletteSize <= 4) ? 2 : 4;
+        
+        putU8(data, paletteSize);
+        for (int i = 0; i < paletteSize; i++)
+            putPixel(data, format, cpixelSize, (const unsigned char *)&palette[i]);
+        
+        for (int y = 0; y < height; y++)
+        {
+            const unsigned int *row = (const unsigned int *)(pixels + y * stride);
+            
+            unsigned int byte = 0;
+            int bitIndex = 8;
+            for (int x = 0; x < width; x++)
+            {
+                unsigned int value = row[x] | 0xff000000;
+                
+                int i = 0;
+                while (palette[i] != value)
+                    i++;
+                
+                bitIndex -= bitNum;
+                byte |= i << bitIndex;
+                
+                if (!bitIndex)
+                {
+                    putU8(data, byte);
+                    byte = 0;
+                    bitIndex = 8;
+                }
+            }
+            
+            if (bitIndex != 8)
+                putU8(data, byte);
+        }
+        
+        return;
+    }
+    
+    if (runNum * (cpixelSize + 1) < width * height * cpixelSize)
+    {
+        putU8(data, 128);
+        
+        int runLength = 0;
+        const unsigned char *runPixel = NULL;
+        for (int y = 0; y < height; y++)
+        {
+            const unsigned int *row = (const unsigned int *)(pixels + y * stride);
+            
+            for (int x = 0; x < width; x++)
+            {
+                if (runLength &&
+                    ((row[x] | 0xff000000) == (*(const unsigned int *)runPixel | 0xff000000)))
+                {
+                    runLength++;
+                    
+                    continue;
+                }
+                
+                if (runLength)
+                {
+                    putPixel(data, format, cpixelSize, runPixel);
+                    for (runLength--; runLength >= 255; runLength -= 255)
+                        putU8(data, 255);
+                    putU8(data, runLength);
+                }
+                
+                runPixel = (const unsigned char *)&row[x];
+                runLength = 1;
+            }
+        }
+        
+        putPixel(data, format, cpixelSize, runPixel);
+        for (runLength--; runLength >= 255; runLength -= 255)
+            putU8(data, 255);
+        putU8(data, runLength);
+        
+        return;
+    }
+    
+    putU8(data, 0);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            putPixel(data, format, cpixelSize, pixels + y * stride + x * 4);
+}
+
+static void encodeRect(vector<unsigned char>& data, RemoteDisplayClient *client,
+                       const RFBPixelFormat& format, int stride, const RFBRect& rect)
+{
+    const unsigned char *pixels = &client->pixels[0];
+    
+    putU16(data, rect.x);
+    putU16(data, rect.y);
+    putU16(data, rect.width);
+    putU16(data, rect.height);
+    
+    if (!client->zrle)
+    {
+        putU32(data, RFB_ENCODING_RAW);
+        
+        int size = format.bitsPerPixel / 8;
+        for (int y = rect.y; y < rect.y + rect.height; y++)
+            for (int x = rect.x; x < rect.x + rect.width; x++)
+                putPixel(data, format, size, pixels + y * stride + x * 4);
+        
+        return;
+    }
+    
+    putU32(data, RFB_ENCODING_ZRLE);
+    
+    vector<unsigned char> tiles;
+    for (int y = rect.y; y < rect.y + rect.height; y += ZRLE_TILESIZE)
+        for (int x = rect.x; x < rect.x + rect.width; x += ZRLE_TILESIZE)
+            encodeZRLETile(tiles, format,
+                           pixels + y * stride + x * 4, stride,
+                           min(ZRLE_TILESIZE, rect.x + rect.width - x),
+                           min(ZRLE_TILESIZE, rect.y + rect.height - y));
+    
+    // The zlib stream lasts as long as the connection
+    vector<unsigned char> compressed(deflateBound(&client->zstream, tiles.size()) + 64);
+    client->zstream.next_in = &tiles[0];
+    client->zstream.avail_in = (uInt) tiles.size();
+    client->zstream.next_out = &compressed[0];
+    client->zstream.avail_out = (uInt) compressed.size();
+    deflate(&client->zstream, Z_SYNC_FLUSH);
+    
+    size_t size = compressed.size() - client->zstream.avail_out;
+    putU32(data, (unsigned int) size);
+    data.insert(data.end(), compressed.begin(), compressed.begin() + size);
+}
+
+// Only the tiles that changed since the last update are sent
+static void getDirtyRects(vector<RFBRect>& rects, RemoteDisplayClient *client,
+                          int stride, int width, int height)
+{
+    const unsigned char *pixels = &client->pixels[0];
+    const unsigned char *lastPixels = &client->lastPixels[0];
+    
+    for (int y = 0; y < height; y += ZRLE_TILESIZE)
+    {
+        int tileHeight = min(ZRLE_TILESIZE, height - y);
+        RFBRect run = {0, y, 0, tileHeight};
+        
+        for (int x = 0; x < width; x += ZRLE_TILESIZE)
+        {
+            int tileWidth = min(ZRLE_TILESIZE, width - x);
+            
+            bool isDirty = false;
+            for (int i = y; (i < y + tileHeight) && !isDirty; i++)
+                isDirty = memcmp(pixels + i * stride + x * 4,
+                                 lastPixels + i * stride + x * 4,
+                                 tileWidth * 4);
+            
+            if (isDirty)
+            {
+                if (!run.width)
+                    run.x = x;
+                run.width = x + tileWidth - run.x;
+            }
+            else if (run.width)
+            {
+                rects.push_back(run);
+                run.width = 0;
+            }
+        }
+        
+        if (run.width)
+            rects.push_back(run);
+    }
+}
+
+// Usage ids of the HID keyboard page are contiguous for letters, digits
+// and function keys
+static int getUsageId(unsigned int keysym, int& unicode)
+{
+    static const struct
+    {
+        unsigned int keysym;
+        int usageId;
+        int unicode;
+    } keyTable[] =
+    {
+        {0xff0d, CANVAS_K_ENTER, '\r'},
+        {0xff1b, CANVAS_K_ESCAPE, 0x1b},
+        {0xff08, CANVAS_K_BACKSPACE, 0x7f},
+        {0xff09, CANVAS_K_TAB, '\t'},
+        {0xffff, CANVAS_K_DELETE, NSDeleteFunctionKey},
+        {0xff63, CANVAS_K_INSERT, NSInsertFunctionKey},
+        {0xff50, CANVAS_K_HOME, NSHomeFunctionKey},
+        {0xff57, CANVAS_K_END, NSEndFunctionKey},
+        {0xff55, CANVAS_K_PAGEUP, NSPageUpFunctionKey},
+        {0xff56, CANVAS_K_PAGEDOWN, NSPageDownFunctionKey},
+        {0xff51, CANVAS_K_LEFT, NSLeftArrowFunctionKey},
+        {0xff52, CANVAS_K_UP, NSUpArrowFunctionKey},
+        {0xff53, CANVAS_K_RIGHT, NSRightArrowFunctionKey},
+        {0xff54, CANVAS_K_DOWN, NSDownArrowFunctionKey},
+        {0xffe1, CANVAS_K_LEFTSHIFT, 0},
+        {0xffe2, CANVAS_K_RIGHTSHIFT, 0},
+        {0xffe3, CANVAS_K_LEFTCONTROL, 0},
+        {0xffe4, CANVAS_K_RIGHTCONTROL, 0},
+        {0xffe5, CANVAS_K_CAPSLOCK, 0},
+        {0xffe7, CANVAS_K_LEFTGUI, 0},
+        {0xffe8, CANVAS_K_RIGHTGUI, 0},
+        {0xffe9, CANVAS_K_LEFTALT, 0},
+        {0xffea, CANVAS_K_RIGHTALT, 0},
+        {0xffeb, CANVAS_K_LEFTGUI, 0},
+        {0xffec, CANVAS_K_RIGHTGUI, 0},
+        {' ', CANVAS_K_SPACE, 0},
+        {'-', CANVAS_K_MINUS, 0}, {'_', CANVAS_K_MINUS, 0},
+        {'=', CANVAS_K_EQUAL, 0}, {'+', CANVAS_K_EQUAL, 0},
+        {'[', CANVAS_K_LEFTBRACKET, 0}, {'{', CANVAS_K_LEFTBRACKET, 0},
+        {']', CANVAS_K_RIGHTBRACKET, 0}, {'}', CANVAS_K_RIGHTBRACKET, 0},
+        {'\\', CANVAS_K_BACKSLASH, 0}, {'|', CANVAS_K_BACKSLASH, 0},
+        {';', CANVAS_K_SEMICOLON, 0}, {':', CANVAS_K_SEMICOLON, 0},
+        {'\'', CANVAS_K_QUOTE, 0}, {'"', CANVAS_K_QUOTE, 0},
+        {'`', CANVAS_K_GRAVEACCENT, 0}, {'~', CANVAS_K_GRAVEACCENT, 0},
+        {',', CANVAS_K_COMMA, 0}, {'<', CANVAS_K_COMMA, 0},
+        {'.', CANVAS_K_PERIOD, 0}, {'>', CANVAS_K_PERIOD, 0},
+        {'/', CANVAS_K_SLASH, 0}, {'?', CANVAS_K_SLASH, 0},
+        {'!', CANVAS_K_1, 0}, {'@', CANVAS_K_2, 0}, {'#', CANVAS_K_3, 0},
+        {'$', CANVAS_K_4, 0}, {'%', CANVAS_K_5, 0}, {'^', CANVAS_K_6, 0},
+        {'&', CANVAS_K_7, 0}, {'*', CANVAS_K_8, 0}, {'(', CANVAS_K_9, 0},
+        {')', CANVAS_K_0, 0},
+    };
+    
+    // Latin-1 and Unicode keysyms carry their character
+    if ((keysym >= 0x20) && (keysym <= 0xff))
+        unicode = keysym;
+    else if ((keysym & 0xff000000) == 0x01000000)
+        unicode = keysym & 0xffffff;
+    else
+        unicode = 0;
+    
+    if ((keysym >= 'a') && (keysym <= 'z'))
+        return CANVAS_K_A + (keysym - 'a');
+    if ((keysym >= 'A') && (keysym <= 'Z'))
+        return CANVAS_K_A + (keysym - 'A');
+    if ((keysym >= '1') && (keysym <= '9'))
+        return CANVAS_K_1 + (keysym - '1');
+    if (keysym == '0')
+        return CANVAS_K_0;
+    if ((keysym >= 0xffbe) && (keysym <= 0xffc9))
+    {
+        unicode = NSF1FunctionKey + (keysym - 0xffbe);
+        
+        return CANVAS_K_F1 + (keysym - 0xffbe);
+    }
+    
+    for (size_t i = 0; i < sizeof(keyTable) / sizeof(keyTable[0]); i++)
+        if (keyTable[i].keysym == keysym)
+        {
+            if (keyTable[i].unicode)
+                unicode = keyTable[i].unicode;
+            
+            return keyTable[i].usageId;
+        }
+    
+    return 0;
+}
+
+@implementation RemoteDisplayServer
+
+- (id)initWithDocument:(Document *)theDocument
+                canvas:(void *)theCanvas
+                  name:(NSString *)theName
+{
+    self = [super init];
+    
+    if (self)
+    {
+        document = [theDocument retain];
+        canvas = theCanvas;
+        name = [theName copy];
+        
+        listenSocket = -1;
+        
+        NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
+        maxFrameRate = [userDefaults doubleForKey:@"OERemoteDisplayMaxFrameRate"];
+        if (maxFrameRate <= 0)
+            maxFrameRate = REMOTEDISPLAY_MAXFRAMERATE;
+        maxBandwidth = [userDefaults doubleForKey:@"OERemoteDisplayMaxBandwidth"];
+        if (maxBandwidth <= 0)
+            maxBandwidth = REMOTEDISPLAY_MAXBANDWIDTH;
+        
+        frameCondition = [[NSCondition alloc] init];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [self close];
+    
+    [document release];
+    [name release];
+    
+    [frameCondition release];
+    
+    free(framePixels);
+    free(capturePixels);
+    
+    [super dealloc];
+}
+
+- (BOOL)open
+{
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+        return NO;
+    
+    int value = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+    
+    // Only local clients; remote viewers can tunnel in
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    NSInteger basePort = [[NSUserDefaults standardUserDefaults]
+                          integerForKey:@"OERemoteDisplayPort"];
+    if (!basePort)
+        basePort = REMOTEDISPLAY_BASEPORT;
+    
+    for (int i = 0; i < REMOTEDISPLAY_PORTNUM; i++)
+    {
+        address.sin_port = htons(basePort + i);
+        
+        if (!bind(listenSocket, (struct sockaddr *)&address, sizeof(address)))
+        {
+            port = (int) basePort + i;
+            
+            break;
+        }
+    }
+    
+    if (!port || (listen(listenSocket, 4) < 0))
+    {
+        close(listenSocket);
+        listenSocket = -1;
+        
+        return NO;
+    }
+    
+    [NSThread detachNewThreadSelector:@selector(acceptClients:)
+                             toTarget:self
+                           withObject:nil];
+    
+    return YES;
+}
+
+- (void)close
+{
+    if (stopRequested)
+        return;
+    
+    // Input is injected on the main thread, so no event reaches the
+    // canvas after this
+    stopRequested = YES;
+    canvas = NULL;
+    
+    if (listenSocket >= 0)
+    {
+        shutdown(listenSocket, SHUT_RDWR);
+        close(listenSocket);
+        listenSocket = -1;
+    }
+    
+    [frameCondition lock];
+    [frameCondition broadcast];
+    [frameCondition unlock];
+    
+    if (sentFrameNum &&
+        [[NSUserDefaults standardUserDefaults] boolForKey:@"OEDebugRenderStatistics"])
+        NSLog(@"%@: sent %lld frames (%.1f MB) to remote displays",
+              name, sentFrameNum, sentByteNum / 1048576.0);
+}
+
+- (int)port
+{
+    return port;
+}
+
+- (NSInteger)clientNum
+{
+    return clientNum;
+}
+
+- (BOOL)isFrameRequested
+{
+    return frameRequested && clientNum;
+}
+
+- (long long)sentFrameNum
+{
+    return sentFrameNum;
+}
+
+- (long long)sentByteNum
+{
+    return sentByteNum;
+}
+
+// Called from the display link thread with the canvas context current.
+// Frames are only read back while clients are connected, and no faster
+// than the frame rate limit; encoding happens on the client threads.
+- (void)captureFrame
+{
+    if (!clientNum || stopRequested)
+        return;
+    
+    double now = CFAbsoluteTimeGetCurrent();
+    if (!frameRequested && ((now - captureTime) < (1.0 / maxFrameRate)))
+        return;
+    captureTime = now;
+    frameRequested = NO;
+    
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    int width = viewport[2];
+    int height = viewport[3];
+    if (!width || !height)
+        return;
+    
+    if ((width != frameWidth) || (height != frameHeight))
+    {
+        [frameCondition lock];
+        
+        free(framePixels);
+        free(capturePixels);
+        framePixels = (unsigned char *)calloc(width * height, 4);
+        capturePixels = (unsigned char *)malloc(width * height * 4);
+        frameWidth = width;
+        frameHeight = height;
+        
+        [frameCondition unlock];
+    }
+    
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, capturePixels);
+    
+    [frameCondition lock];
+    
+    unsigned char *pixels = framePixels;
+    framePixels = capturePixels;
+    capturePixels = pixels;
+    frameSequence++;
+    
+    [frameCondition broadcast];
+    [frameCondition unlock];
+}
+
+- (void)acceptClients:(id)sender
+{
+    while (!stopRequested)
+    {
+        int clientSocket = accept(listenSocket, NULL, NULL);
+        if (clientSocket < 0)
+            break;
+        
+        int value = 1;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+        setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, &value, sizeof(value));
+        
+        RemoteDisplayClient *client = new RemoteDisplayClient();
+        client->socket = clientSocket;
+        
+        [NSThread detachNewThreadSelector:@selector(serveClient:)
+                                 toTarget:self
+                               withObject:[NSValue valueWithPointer:client]];
+    }
+}
+
+- (BOOL)handshakeClient:(RemoteDisplayClient *)client
+{
+    int fd = client->socket;
+    
+    const char *version = "RFB 003.008\n";
+    char clientVersion[13] = {0};
+    if (!sendAll(fd, version, 12) ||
+        !readAll(fd, clientVersion, 12) ||
+        strncmp(clientVersion, "RFB ", 4))
+        return NO;
+    
+    int minor = atoi(clientVersion + 8);
+    
+    // No authentication: the server only listens on the loopback interface
+    vector<unsigned char> data;
+    if (minor < 7)
+    {
+        putU32(data, 1);
+        if (!sendAll(fd, &data[0], data.size()))
+            return NO;
+    }
+    else
+    {
+        unsigned char securityTypes[2] = {1, 1};
+        unsigned char securityType;
+        if (!sendAll(fd, securityTypes, 2) ||
+            !readAll(fd, &securityType, 1) ||
+            (securityType != 1))
+            return NO;
+        
+        if (minor >= 8)
+        {
+            putU32(data, 0);
+            if (!sendAll(fd, &data[0], data.size()))
+                return NO;
+        }
+    }
+    
+    unsigned char shared;
+    if (!readAll(fd, &shared, 1))
+        return NO;
+    
+    // The size of the first frame is the size of the desktop. An idle
+    // canvas does not vsync, so the current frame is requested explicitly
+    frameRequested = YES;
+    
+    [frameCondition lock];
+    
+    NSDate *limitDate = [NSDate dateWithTimeIntervalSinceNow:2];
+    while (!frameSequence && !stopRequested &&
+           [frameCondition waitUntilDate:limitDate])
+        ;
+    
+    client->width = frameSequence ? frameWidth : 640;
+    client->height = frameSequence ? frameHeight : 480;
+    
+    [frameCondition unlock];
+    
+    const unsigned char defaultFormat[16] = {
+        32, 24, 0, 1, 0, 255, 0, 255, 0, 255, 16, 8, 0, 0, 0, 0,
+    };
+    setPixelFormat(client->format, defaultFormat);
+    
+    string utf8Name = [name cppString];
+    
+    data.clear();
+    putU16(data, client->width);
+    putU16(data, client->height);
+    data.insert(data.end(), defaultFormat, defaultFormat + 16);
+    putU32(data, (unsigned int) utf8Name.size());
+    data.insert(data.end(), utf8Name.begin(), utf8Name.end());
+    
+    return sendAll(fd, &data[0], data.size());
+}
+
+- (void)serveClient:(NSValue *)clientValue
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    RemoteDisplayClient *client = (RemoteDisplayClient *)[clientValue pointerValue];
+    
+    OSAtomicIncrement32Barrier(&clientNum);
+    
+    if ([self handshakeClient:client])
+    {
+        deflateInit(&client->zstream, Z_DEFAULT_COMPRESSION);
+        client->bandwidthCredit = maxBandwidth;
+        client->bandwidthTime = CFAbsoluteTimeGetCurrent();
+        
+        [NSThread detachNewThreadSelector:@selector(encodeClient:)
+                                 toTarget:self
+                               withObject:clientValue];
+        
+        while (!stopRequested && [self readMessage:client])
+            ;
+        
+        // Queued input is handled before the client goes away
+        [self performSelectorOnMainThread:@selector(releaseInput:)
+                               withObject:clientValue
+                            waitUntilDone:YES];
+        
+        [frameCondition lock];
+        
+        client->closed = true;
+        [frameCondition broadcast];
+        
+        while (!client->encoderDone)
+            [frameCondition wait];
+        
+        [frameCondition unlock];
+        
+        deflateEnd(&client->zstream);
+    }
+    
+    close(client->socket);
+    delete client;
+    
+    OSAtomicDecrement32Barrier(&clientNum);
+    
+    [pool drain];
+}
+
+- (BOOL)readMessage:(RemoteDisplayClient *)client
+{
+    int fd = client->socket;
+    unsigned char data[20];
+    
+    if (!readAll(fd, data, 1))
+        return NO;
+    
+    switch (data[0])
+    {
+        case 0:
+            // SetPixelFormat: only true color formats are supported
+            if (!readAll(fd, data, 19))
+                return NO;
+            
+            if (data[6] &&
+                ((data[3] == 8) || (data[3] == 16) || (data[3] == 32)))
+            {
+                [frameCondition lock];
+                
+                setPixelFormat(client->format, data + 3);
+                client->fullUpdateRequested = true;
+                
+                [frameCondition unlock];
+            }
+            
+            return YES;
+        
+        case 2:
+        {
+            // SetEncodings
+            if (!readAll(fd, data, 3))
+                return NO;
+            
+            int encodingNum = (data[1] << 8) | data[2];
+            bool zrle = false;
+            bool desktopSize = false;
+            for (int i = 0; i < encodingNum; i++)
+            {
+                if (!readAll(fd, data, 4))
+                    return NO;
+                
+                int encoding = (int) ((data[0] << 24) | (data[1] << 16) |
+                                      (data[2] << 8) | data[3]);
+                if (encoding == RFB_ENCODING_ZRLE)
+                    zrle = true;
+                else if (encoding == RFB_ENCODING_DESKTOPSIZE)
+                    desktopSize = true;
+            }
+            
+            [frameCondition lock];
+            
+            client->zrle = zrle;
+            client->desktopSize = desktopSize;
+            
+            [frameCondition unlock];
+            
+            return YES;
+        }
+        case 3:
+            // FramebufferUpdateRequest: the whole desktop is always considered
+            if (!readAll(fd, data, 9))
+                return NO;
+            
+            [frameCondition lock];
+            
+            client->updateRequested = true;
+            if (!data[0])
+                client->fullUpdateRequested = true;
+            
+            [frameCondition broadcast];
+            [frameCondition unlock];
+            
+            return YES;
+        
+        case 4:
+            // KeyEvent
+            if (!readAll(fd, data, 7))
+                return NO;
+            
+            [self performSelectorOnMainThread:@selector(sendKey:)
+                                   withObject:[NSArray arrayWithObjects:
+                                               [NSValue valueWithPointer:client],
+                                               [NSNumber numberWithUnsignedInt:
+                                                ((data[3] << 24) | (data[4] << 16) |
+                                                 (data[5] << 8) | data[6])],
+                                               [NSNumber numberWithBool:data[0]],
+                                               nil]
+                                waitUntilDone:NO];
+            
+            return YES;
+        
+        case 5:
+            // PointerEvent
+            if (!readAll(fd, data, 5))
+                return NO;
+            
+            [self performSelectorOnMainThread:@selector(sendPointer:)
+                                   withObject:[NSArray arrayWithObjects:
+                                               [NSValue valueWithPointer:client],
+                                               [NSNumber numberWithInt:data[0]],
+                                               [NSNumber numberWithInt:((data[1] << 8) | data[2])],
+                                               [NSNumber numberWithInt:((data[3] << 8) | data[4])],
+                                               nil]
+                                waitUntilDone:NO];
+            
+            return YES;
+        
+        case 6:
+        {
+            // ClientCutText: ISO 8859-1 text is pasted into the canvas
+            if (!readAll(fd, data, 7))
+                return NO;
+            
+            unsigned int size = (data[3] << 24) | (data[4] << 16) | (data[5] << 8) | data[6];
+            if (size > RFB_CUTTEXT_MAXSIZE)
+                return NO;
+            
+            vector<unsigned char> text(size + 1);
+            if (size && !readAll(fd, &text[0], size))
+                return NO;
+            
+            NSString *clipboard = [[[NSString alloc] initWithBytes:&text[0]
+                                                            length:size
+                                                          encoding:NSISOLatin1StringEncoding]
+                                   autorelease];
+            
+            [self performSelectorOnMainThread:@selector(sendPaste:)
+                                   withObject:clipboard
+                                waitUntilDone:NO];
+            
+            return YES;
+        }
+        default:
+            return NO;
+    }
+}
+
+- (void)encodeClient:(NSValue *)clientValue
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    RemoteDisplayClient *client = (RemoteDisplayClient *)[clientValue pointerValue];
+    
+    [frameCondition lock];
+    
+    while (!client->closed && !stopRequested)
+    {
+        if (!client->updateRequested ||
+            !frameSequence ||
+            (!client->fullUpdateRequested && (frameSequence == client->lastSequence)))
+        {
+            [frameCondition wait];
+            
+            continue;
+        }
+        
+        // Frame rate and bandwidth limits delay the update, so the next
+        // one carries the latest frame instead of a backlog
+        double now = CFAbsoluteTimeGetCurrent();
+        client->bandwidthCredit = min(maxBandwidth,
+                                      client->bandwidthCredit +
+                                      (now - client->bandwidthTime) * maxBandwidth);
+        client->bandwidthTime = now;
+        
+        double delay = max(client->updateTime + 1.0 / maxFrameRate - now,
+                           -client->bandwidthCredit / maxBandwidth);
+        if (delay > 0)
+        {
+            [frameCondition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:delay]];
+            
+            continue;
+        }
+        
+        // Copy the frame top row first, as RFB expects
+        int width = frameWidth;
+        int height = frameHeight;
+        
+        bool isFull = (client->fullUpdateRequested ||
+                       (width != client->lastWidth) ||
+                       (height != client->lastHeight));
+        
+        client->pixels.resize(width * height * 4);
+        for (int y = 0; y < height; y++)
+            memcpy(&client->pixels[y * width * 4],
+                   framePixels + (height - 1 - y) * width * 4,
+                   width * 4);
+        
+        client->lastSequence = frameSequence;
+        client->updateRequested = false;
+        client->fullUpdateRequested = false;
+        
+        RFBPixelFormat format = client->format;
+        bool desktopSize = client->desktopSize;
+        
+        [frameCondition unlock];
+        
+        vector<RFBRect> rects;
+        vector<unsigned char> data;
+        
+        bool isResized = ((width != client->width) || (height != client->height));
+        if (isResized && desktopSize)
+        {
+            client->width = width;
+            client->height = height;
+        }
+        
+        // Clients without DesktopSize keep their size; the frame is clipped
+        int clipWidth = min(width, client->width);
+        int clipHeight = min(height, client->height);
+        
+        if (isFull)
+        {
+            RFBRect rect = {0, 0, clipWidth, clipHeight};
+            rects.push_back(rect);
+        }
+        else
+            getDirtyRects(rects, client, width * 4, clipWidth, clipHeight);
+        
+        bool isSent = true;
+        if (rects.size() || (isResized && desktopSize))
+        {
+            putU8(data, 0);
+            putU8(data, 0);
+            putU16(data, (unsigned int) rects.size() + ((isResized && desktopSize) ? 1 : 0));
+            
+            if (isResized && desktopSize)
+            {
+                putU16(data, 0);
+                putU16(data, 0);
+                putU16(data, width);
+                putU16(data, height);
+                putU32(data, RFB_ENCODING_DESKTOPSIZE);
+            }
+            
+            for (size_t i = 0; i < rects.size(); i++)
+                encodeRect(data, client, format, width * 4, rects[i]);
+            
+            isSent = sendAll(client->socket, &data[0], data.size());
+            
+            OSAtomicIncrement64(&sentFrameNum);
+            OSAtomicAdd64(data.size(), &sentByteNum);
+        }
+        
+        client->pixels.swap(client->lastPixels);
+        
+        [frameCondition lock];
+        
+        client->lastWidth = width;
+        client->lastHeight = height;
+        client->updateTime = now;
+        client->bandwidthCredit -= data.size();
+        
+        // Nothing changed: the request stays pending for the next frame
+        if (data.empty())
+            client->updateRequested = true;
+        
+        if (!isSent)
+            client->closed = true;
+    }
+    
+    // Wakes up the reader thread of the client
+    shutdown(client->socket, SHUT_RDWR);
+    
+    client->encoderDone = true;
+    
+    [frameCondition broadcast];
+    [frameCondition unlock];
+    
+    [pool drain];
+}
+
+// Input is sent from the main thread, as CanvasView does
+
+- (void)sendKey:(NSArray *)args
+{
+    RemoteDisplayClient *client = (RemoteDisplayClient *)[[args objectAtIndex:0] pointerValue];
+    unsigned int keysym = [[args objectAtIndex:1] unsignedIntValue];
+    BOOL down = [[args objectAtIndex:2] boolValue];
+    
+    OpenGLCanvas *theCanvas = (OpenGLCanvas *)canvas;
+    if (!theCanvas)
+        return;
+    
+    int unicode;
+    int usageId = getUsageId(keysym, unicode);
+    
+    [document lockEmulation];
+    
+    InputRecorder *inputRecorder = (InputRecorder *)[document inputRecorder];
+    
+    // Clients repeat key downs; the canvas only sees the first
+    if (usageId)
+    {
+        if (down && !client->keysDown.count(usageId))
+        {
+            client->keysDown.insert(usageId);
+            
+            theCanvas->setKey(usageId, true);
+            if (inputRecorder)
+                inputRecorder->recordKey(theCanvas, usageId, true);
+        }
+        else if (!down && client->keysDown.count(usageId))
+        {
+            client->keysDown.erase(usageId);
+            
+            theCanvas->setKey(usageId, false);
+            if (inputRecorder)
+                inputRecorder->recordKey(theCanvas, usageId, false);
+        }
+    }
+    
+    if (down && unicode)
+    {
+        theCanvas->sendUnicodeChar((CanvasUnicodeChar) unicode);
+        if (inputRecorder)
+            inputRecorder->recordUnicodeChar(theCanvas, unicode);
+    }
+    
+    [document unlockEmulation];
+}
+
+- (void)sendPointer:(NSArray *)args
+{
+    RemoteDisplayClient *client = (RemoteDisplayClient *)[[args objectAtIndex:0] pointerValue];
+    int buttonMask = [[args objectAtIndex:1] intValue];
+    int x = [[args objectAtIndex:2] intValue];
+    int y = [[args objectAtIndex:3] intValue];
+    
+    // RFB buttons are left, middle, right, then the wheel directions
+    const int buttonMap[3] = {0, 2, 1};
+    
+    OpenGLCanvas *theCanvas = (OpenGLCanvas *)canvas;
+    if (!theCanvas)
+        return;
+    
+    [frameCondition lock];
+    
+    int width = client->width;
+    int height = client->height;
+    
+    [frameCondition unlock];
+    
+    if (!width || !height)
+        return;
+    
+    [document lockEmulation];
+    
+    InputRecorder *inputRecorder = (InputRecorder *)[document inputRecorder];
+    
+    if (!client->pointerEntered)
+    {
+        client->pointerEntered = true;
+        client->pointerX = x;
+        client->pointerY = y;
+        
+        theCanvas->enterMouse();
+        if (inputRecorder)
+            inputRecorder->recordMouseEnter(theCanvas);
+    }
+    
+    float fx = (float) x / width;
+    float fy = (float) y / height;
+    float rx = (float) (x - client->pointerX);
+    float ry = (float) (y - client->pointerY);
+    
+    theCanvas->setMousePosition(fx, fy);
+    if (inputRecorder)
+        inputRecorder->recordMousePosition(theCanvas, fx, fy);
+    if (rx || ry)
+    {
+        theCanvas->moveMouse(rx, ry);
+        if (inputRecorder)
+            inputRecorder->recordMouseMove(theCanvas, rx, ry);
+    }
+    
+    client->pointerX = x;
+    client->pointerY = y;
+    
+    for (int i = 0; i < 3; i++)
+    {
+        bool value = OEGetBit(buttonMask, 1 << i);
+        if (value != OEGetBit(client->buttonMask, 1 << i))
+        {
+            theCanvas->setMouseButton(buttonMap[i], value);
+            if (inputRecorder)
+                inputRecorder->recordMouseButton(theCanvas, buttonMap[i], value);
+        }
+    }
+    
+    // Wheel buttons are pressed and released for every step
+    const struct
+    {
+        int bit;
+        int axis;
+        float delta;
+    } wheelMap[4] = {{3, 1, 1}, {4, 1, -1}, {5, 0, 1}, {6, 0, -1}};
+    
+    for (int i = 0; i < 4; i++)
+    {
+        if (OEGetBit(buttonMask, 1 << wheelMap[i].bit) &&
+            !OEGetBit(client->buttonMask, 1 << wheelMap[i].bit))
+        {
+            theCanvas->sendMouseWheelEvent(wheelMap[i].axis, wheelMap[i].delta);
+            if (inputRecorder)
+                inputRecorder->recordMouseWheel(theCanvas, wheelMap[i].axis, wheelMap[i].delta);
+        }
+    }
+    
+    client->buttonMask = buttonMask;
+    
+    [document unlockEmulation];
+}
+
+- (void)sendPaste:(NSString *)text
+{
+    OpenGLCanvas *theCanvas = (OpenGLCanvas *)canvas;
+    if (!theCanvas)
+        return;
+    
+    wstring clipboard = [text cppWString];
+    
+    [document lockEmulation];
+    
+    theCanvas->doPaste(clipboard);
+    
+    InputRecorder *inputRecorder = (InputRecorder *)[document inputRecorder];
+    if (inputRecorder)
+        inputRecorder->recordPaste(theCanvas, clipboard);
+    
+    [document unlockEmulation];
+}
+
+// A disconnecting client must not leave keys or buttons down
+- (void)releaseInput:(NSValue *)clientValue
+{
+    RemoteDisplayClient *client = (RemoteDisplayClient *)[clientValue pointerValue];
+    
+    const int buttonMap[3] = {0, 2, 1};
+    
+    OpenGLCanvas *theCanvas = (OpenGLCanvas *)canvas;
+    if (!theCanvas)
+        return;
+    
+    [document lockEmulation];
+    
+    InputRecorder *inputRecorder = (InputRecorder *)[document inputRecorder];
+    
+    for (set<int>::iterator i = client->keysDown.begin();
+         i != client->keysDown.end();
+         i++)
+    {
+        theCanvas->setKey(*i, false);
+        if (inputRecorder)
+            inputRecorder->recordKey(theCanvas, *i, false);
+    }
+    
+    for (int i = 0; i < 3; i++)
+    {
+        if (OEGetBit(client->buttonMask, 1 << i))
+        {
+            theCanvas->setMouseButton(buttonMap[i], false);
+            if (inputRecorder)
+                inputRecorder->recordMouseButton(theCanvas, buttonMap[i], false);
+        }
+    }
+    
+    if (client->pointerEntered)
+    {
+        theCanvas->exitMouse();
+        if (inputRecorder)
+            inputRecorder->recordMouseExit(theCanvas);
+    }
+    
+    [document unlockEmulation];
+}
+
+@end
@@ -0,0 +1,41 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Render Regression
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Compares canvas frames against golden images
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define RENDERREGRESSION_ARGUMENT       @"--render-regression"
+#define RENDERREGRESSION_CYCLES         @"2045454,5113635"
+#define RENDERREGRESSION_TOLERANCE      8
+#define RENDERREGRESSION_MAXMISMATCH    0.1
+#define RENDERREGRESSION_TIMEOUT        60.0
+
+@interface RenderRegression : NSObject
+{
+    NSString *goldenPath;
+    NSMutableArray *templatePaths;
+    NSMutableArray *cycles;
+    BOOL update;
+    NSInteger tolerance;
+    double maxMismatch;
+    double timeout;
+    
+    NSInteger frameNum;
+    NSInteger failureNum;
+    double renderTime;
+    double renderMaxTime;
+}
+
++ (BOOL)isRequested;
++ (void)runWithProcessArguments;
+
+- (id)initWithArguments:(NSArray *)arguments;
+- (int)run;
+
+@end
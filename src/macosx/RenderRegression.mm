@@ -0,0 +1,383 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Render Regression
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Compares canvas frames against golden images
+ */
+
+#import "RenderRegression.h"
+
+#import "DocumentController.h"
+#import "Document.h"
+#import "CanvasWindowController.h"
+
+#import "FrameBarrier.h"
+#import "OEEmulation.h"
+#import "OpenGLCanvas.h"
+
+@implementation RenderRegression
+
++ (BOOL)isRequested
+{
+    return [[[NSProcessInfo processInfo] arguments] containsObject:RENDERREGRESSION_ARGUMENT];
+}
+
++ (void)runWithProcessArguments
+{
+    NSArray *arguments = [[NSProcessInfo processInfo] arguments];
+    NSUInteger index = [arguments indexOfObject:RENDERREGRESSION_ARGUMENT];
+    arguments = [arguments subarrayWithRange:NSMakeRange(index + 1,
+                                                         [arguments count] - index - 1)];
+    
+    RenderRegression *renderRegression = [[RenderRegression alloc] initWithArguments:arguments];
+    
+    int result = renderRegression ? [renderRegression run] : 2;
+    
+    [renderRegression release];
+    
+    exit(result);
+}
+
+- (id)initWithArguments:(NSArray *)arguments
+{
+    self = [super init];
+    
+    if (self)
+    {
+        templatePaths = [[NSMutableArray alloc] init];
+        cycles = [[NSMutableArray alloc] init];
+        tolerance = RENDERREGRESSION_TOLERANCE;
+        maxMismatch = RENDERREGRESSION_MAXMISMATCH;
+        timeout = RENDERREGRESSION_TIMEOUT;
+        
+        NSString *cyclesString = RENDERREGRESSION_CYCLES;
+        
+        for (NSUInteger i = 0; i < [arguments count]; i++)
+        {
+            NSString *argument = [arguments objectAtIndex:i];
+            BOOL hasValue = (i + 1 < [arguments count]);
+            
+            if ([argument isEqualToString:@"--update"])
+                update = YES;
+            else if ([argument isEqualToString:@"--cycles"] && hasValue)
+                cyclesString = [arguments objectAtIndex:++i];
+            else if ([argument isEqualToString:@"--tolerance"] && hasValue)
+                tolerance = [[arguments objectAtIndex:++i] integerValue];
+            else if ([argument isEqualToString:@"--max-mismatch"] && hasValue)
+                maxMismatch = [[arguments objectAtIndex:++i] doubleValue];
+            else if ([argument isEqualToString:@"--timeout"] && hasValue)
+                timeout = [[arguments objectAtIndex:++i] doubleValue];
+            else if (!goldenPath)
+                goldenPath = [[argument stringByExpandingTildeInPath] copy];
+            else
+                [templatePaths addObject:[argument stringByExpandingTildeInPath]];
+        }
+        
+        for (NSString *value in [cyclesString componentsSeparatedByString:@","])
+            [cycles addObject:[NSNumber numberWithLongLong:[value longLongValue]]];
+        
+        if (!goldenPath)
+        {
+            fprintf(stderr, "usage: OpenEmulator --render-regression <golden directory> "
+                    "[--update] [--cycles n,...] [--tolerance n] [--max-mismatch percent] "
+                    "[--timeout seconds] [template ...]\n");
+            
+            [self release];
+            
+            return nil;
+        }
+        
+        // Default to the bundled reference machines
+        if (![templatePaths count])
+        {
+            NSFileManager *fileManager = [NSFileManager defaultManager];
+            NSString *templatesPath = [[[NSUserDefaults standardUserDefaults]
+                                        URLForKey:@"OEDefaultResourcesPath"].path
+                                       stringByAppendingPathComponent:@"templates"];
+            
+            for (NSString *group in [fileManager contentsOfDirectoryAtPath:templatesPath
+                                                                     error:nil])
+            {
+                NSString *groupPath = [templatesPath stringByAppendingPathComponent:group];
+                
+                for (NSString *filename in [fileManager contentsOfDirectoryAtPath:groupPath
+                                                                            error:nil])
+                {
+                    NSString *pathExtension = [[filename pathExtension] lowercaseString];
+                    if (([pathExtension compare:@"xml"] == NSOrderedSame) ||
+                        ([pathExtension compare:@OE_PACKAGE_PATH_EXTENSION] == NSOrderedSame))
+                        [templatePaths addObject:[groupPath
+                                                  stringByAppendingPathComponent:filename]];
+                }
+            }
+        }
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [goldenPath release];
+    [templatePaths release];
+    [cycles release];
+    
+    [super dealloc];
+}
+
+// Returns the percentage of pixels whose red, green or blue sample differs
+// by more than the tolerance, or -1 if the images cannot be compared
+- (double)mismatchOf:(NSBitmapImageRep *)bitmap against:(NSBitmapImageRep *)golden
+{
+    NSInteger width = [bitmap pixelsWide];
+    NSInteger height = [bitmap pixelsHigh];
+    
+    if (([golden pixelsWide] != width) ||
+        ([golden pixelsHigh] != height) ||
+        ([golden bitsPerSample] != 8) ||
+        ([golden samplesPerPixel] < 3) ||
+        [golden isPlanar])
+        return -1;
+    
+    if (!width || !height)
+        return 0;
+    
+    NSInteger bitmapStride = [bitmap bitsPerPixel] / 8;
+    NSInteger goldenStride = [golden bitsPerPixel] / 8;
+    
+    long long mismatchNum = 0;
+    for (NSInteger y = 0; y < height; y++)
+    {
+        unsigned char *p = [bitmap bitmapData] + y * [bitmap bytesPerRow];
+        unsigned char *q = [golden bitmapData] + y * [golden bytesPerRow];
+        
+        for (NSInteger x = 0; x < width; x++, p += bitmapStride, q += goldenStride)
+        {
+            if ((abs(p[0] - q[0]) > tolerance) ||
+                (abs(p[1] - q[1]) > tolerance) ||
+                (abs(p[2] - q[2]) > tolerance))
+                mismatchNum++;
+        }
+    }
+    
+    return 100.0 * mismatchNum / (width * height);
+}
+
+- (void)captureCanvasView:(CanvasView *)canvasView path:(NSString *)path
+{
+    NSRect rect;
+    rect.origin = NSMakePoint(0, 0);
+    rect.size = [canvasView canvasSize];
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
+    NSBitmapImageRep *bitmap = [canvasView canvasBitmap:rect];
+    
+    double frameTime = CFAbsoluteTimeGetCurrent() - startTime;
+    
+    NSString *frameName = [[[path stringByDeletingLastPathComponent] lastPathComponent]
+                           stringByAppendingPathComponent:[path lastPathComponent]];
+    
+    frameNum++;
+    renderTime += frameTime;
+    if (frameTime > renderMaxTime)
+        renderMaxTime = frameTime;
+    
+    if (!bitmap)
+    {
+        printf("%s: no image\n", [frameName UTF8String]);
+        
+        failureNum++;
+        
+        return;
+    }
+    
+    NSData *data = [bitmap representationUsingType:NSPNGFileType
+                                        properties:[NSDictionary dictionary]];
+    
+    NSBitmapImageRep *golden = nil;
+    if (!update)
+        golden = [NSBitmapImageRep imageRepWithContentsOfFile:path];
+    
+    if (update)
+    {
+        [data writeToFile:path atomically:YES];
+        
+        printf("%s: golden written, render %.2f ms\n",
+               [frameName UTF8String], frameTime * 1000);
+        
+        return;
+    }
+    
+    if (!golden)
+    {
+        [data writeToFile:[[path stringByDeletingPathExtension]
+                           stringByAppendingString:@".actual.png"]
+               atomically:YES];
+        
+        printf("%s: FAIL no golden image, render %.2f ms\n",
+               [frameName UTF8String], frameTime * 1000);
+        
+        failureNum++;
+        
+        return;
+    }
+    
+    double mismatch = [self mismatchOf:bitmap against:golden];
+    BOOL isPassed = (mismatch >= 0) && (mismatch <= maxMismatch);
+    
+    if (!isPassed)
+    {
+        // Keep the actual frame next to the golden one for inspection
+        [data writeToFile:[[path stringByDeletingPathExtension]
+                           stringByAppendingString:@".actual.png"]
+               atomically:YES];
+        
+        failureNum++;
+    }
+    
+    if (mismatch < 0)
+        printf("%s: FAIL size or format differs, render %.2f ms\n",
+               [frameName UTF8String], frameTime * 1000);
+    else
+        printf("%s: %s %.3f%% pixels differ, render %.2f ms\n",
+               [frameName UTF8String],
+               isPassed ? "ok" : "FAIL",
+               mismatch,
+               frameTime * 1000);
+}
+
+- (void)runTemplate:(NSString *)templatePath
+{
+    DocumentController *documentController = [NSDocumentController sharedDocumentController];
+    NSString *name = [[templatePath lastPathComponent] stringByDeletingPathExtension];
+    
+    NSError *error = nil;
+    Document *document = [documentController openUntitledDocumentWithTemplateURL:
+                          [NSURL fileURLWithPath:templatePath]
+                                                                       display:NO
+                                                                         error:&error];
+    if (!document || ![document emulation])
+    {
+        printf("%s: cannot open template\n", [name UTF8String]);
+        
+        failureNum++;
+        
+        return;
+    }
+    
+    // Canvas views are loaded, but their windows are never shown
+    NSArray *canvasWindowControllers = [[[document canvasWindowControllers] copy] autorelease];
+    for (CanvasWindowController *canvasWindowController in canvasWindowControllers)
+    {
+        if (![[document windowControllers] containsObject:canvasWindowController])
+            [document addWindowController:canvasWindowController];
+        
+        [canvasWindowController window];
+    }
+    
+    FrameBarrier *frameBarrier = new FrameBarrier();
+    
+    [document lockEmulation];
+    
+    frameBarrier->setEmulation((OEEmulation *)[document emulation]);
+    frameBarrier->setAudio((OEComponent *)[documentController paAudio]);
+    
+    [document unlockEmulation];
+    
+    NSString *templateGoldenPath = [goldenPath stringByAppendingPathComponent:name];
+    [[NSFileManager defaultManager] createDirectoryAtPath:templateGoldenPath
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    
+    for (NSNumber *targetCycles in cycles)
+    {
+        if (!frameBarrier->waitForCycles([targetCycles longLongValue], (float) timeout))
+        {
+            printf("%s: cycle %lld not reached\n", [name UTF8String],
+                   [targetCycles longLongValue]);
+            
+            failureNum++;
+            
+            break;
+        }
+        
+        // The emulation is held at a step boundary while frames are captured
+        for (NSUInteger i = 0; i < [canvasWindowControllers count]; i++)
+        {
+            CanvasWindowController *canvasWindowController;
+            canvasWindowController = [canvasWindowControllers objectAtIndex:i];
+            CanvasView *canvasView = [canvasWindowController canvasView];
+            OpenGLCanvas *canvas = (OpenGLCanvas *)[canvasWindowController canvas];
+            
+            NSString *prefix = [NSString stringWithFormat:@"canvas%lu-%lld",
+                                (unsigned long) i, [targetCycles longLongValue]];
+            
+            if ([canvasView isDisplayCanvas])
+            {
+                canvas->setEnableShader(false);
+                [self captureCanvasView:canvasView
+                                   path:[templateGoldenPath stringByAppendingPathComponent:
+                                         [prefix stringByAppendingString:@"-plain.png"]]];
+                
+                canvas->setEnableShader(true);
+                [self captureCanvasView:canvasView
+                                   path:[templateGoldenPath stringByAppendingPathComponent:
+                                         [prefix stringByAppendingString:@"-shader.png"]]];
+                
+                canvas->setEnableShader([[NSUserDefaults standardUserDefaults]
+                                         boolForKey:@"OEVideoEnableShader"]);
+            }
+            else
+                [self captureCanvasView:canvasView
+                                   path:[templateGoldenPath stringByAppendingPathComponent:
+                                         [prefix stringByAppendingString:@".png"]]];
+        }
+        
+        if (!frameBarrier->release())
+        {
+            printf("%s: FAIL cycle %lld hold timed out, frames may be from a running emulation\n",
+                   [name UTF8String], [targetCycles longLongValue]);
+            
+            failureNum++;
+        }
+    }
+    
+    frameBarrier->release();
+    
+    [document lockEmulation];
+    
+    frameBarrier->setAudio(NULL);
+    
+    [document unlockEmulation];
+    
+    delete frameBarrier;
+    
+    [document close];
+}
+
+- (int)run
+{
+    for (NSString *templatePath in templatePaths)
+    {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        
+        [self runTemplate:templatePath];
+        
+        [pool drain];
+    }
+    
+    printf("%ld frames, %ld failed, render average %.2f ms, max %.2f ms\n",
+           (long) frameNum,
+           (long) failureNum,
+           frameNum ? renderTime / frameNum * 1000 : 0,
+           renderMaxTime * 1000);
+    
+    return failureNum ? 1 : 0;
+}
+
+@end
@@ -0,0 +1,36 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Settings Transaction
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Stages device settings and applies them in one pass
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#import "Document.h"
+
+@interface SettingsTransaction : NSObject
+{
+    Document *document;
+    
+    NSMutableArray *components;
+    NSMutableArray *names;
+    NSMutableArray *values;
+}
+
+- (id)initWithDocument:(Document *)theDocument;
+
+- (void)setValue:(NSString *)value
+      forSetting:(NSString *)name
+     ofComponent:(void *)component;
+- (BOOL)setValue:(NSString *)value
+      forSetting:(NSString *)name
+ ofComponentWithId:(NSString *)componentId;
+
+- (NSUInteger)count;
+- (BOOL)commit;
+
+@end
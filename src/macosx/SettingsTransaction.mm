@@ -0,0 +1,206 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Settings Transaction
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Stages device settings and applies them in one pass
+ */
+
+#import "SettingsTransaction.h"
+
+#import "NSStringAdditions.h"
+
+#import "OEEmulation.h"
+
+@implementation SettingsTransaction
+
+- (id)initWithDocument:(Document *)theDocument
+{
+    self = [super init];
+    
+    if (self)
+    {
+        document = theDocument;
+        
+        components = [[NSMutableArray alloc] init];
+        names = [[NSMutableArray alloc] init];
+        values = [[NSMutableArray alloc] init];
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [components release];
+    [names release];
+    [values release];
+    
+    [super dealloc];
+}
+
+// A later value for the same setting replaces the staged one
+- (void)setValue:(NSString *)value
+      forSetting:(NSString *)name
+     ofComponent:(void *)component
+{
+    if (!component)
+        return;
+    
+    NSValue *theComponent = [NSValue valueWithPointer:component];
+    
+    for (NSUInteger i = 0; i < [components count]; i++)
+    {
+        if ([[components objectAtIndex:i] isEqualToValue:theComponent] &&
+            ([[names objectAtIndex:i] compare:name] == NSOrderedSame))
+        {
+            [values replaceObjectAtIndex:i withObject:value];
+            
+            return;
+        }
+    }
+    
+    [components addObject:theComponent];
+    [names addObject:name];
+    [values addObject:value];
+}
+
+- (BOOL)setValue:(NSString *)value
+      forSetting:(NSString *)name
+ ofComponentWithId:(NSString *)componentId
+{
+    OEEmulation *emulation = (OEEmulation *)[document emulation];
+    if (!emulation)
+        return NO;
+    
+    [document lockEmulation];
+    
+    OEComponent *component = emulation->getComponent([componentId cppString]);
+    
+    [document unlockEmulation];
+    
+    if (!component)
+        return NO;
+    
+    [self setValue:value forSetting:name ofComponent:component];
+    
+    return YES;
+}
+
+- (NSUInteger)count
+{
+    return [components count];
+}
+
+// All staged values are set and validated within a single emulation lock,
+// so the emulation only observes them between two steps. Each component is
+// then updated once. If any value cannot be read or is rejected, or any
+// update fails, the previous values are restored and the affected
+// components updated again.
+- (BOOL)commit
+{
+    NSUInteger count = [components count];
+    if (!count)
+        return YES;
+    
+    BOOL isDebug = [[NSUserDefaults standardUserDefaults]
+                    boolForKey:@"OEDebugSettingsTransactions"];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    
+    NSMutableArray *oldValues = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray *updateComponents = [NSMutableArray array];
+    NSUInteger appliedNum = 0;
+    BOOL success = YES;
+    
+    [document lockEmulation];
+    
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        OEComponent *component = (OEComponent *)[[components objectAtIndex:i]
+                                                 pointerValue];
+        string name = [[names objectAtIndex:i] cppString];
+        
+        // A setting that cannot be read back could not be restored
+        string oldValue;
+        if (!component->getValue(name, oldValue))
+        {
+            if (isDebug)
+                NSLog(@"Settings transaction: %@ cannot be read",
+                      [names objectAtIndex:i]);
+            
+            success = NO;
+            
+            break;
+        }
+        
+        [oldValues addObject:[NSString stringWithCPPString:oldValue]];
+        
+        if (!component->setValue(name, [[values objectAtIndex:i] cppString]))
+        {
+            if (isDebug)
+                NSLog(@"Settings transaction: %@ rejected value \"%@\"",
+                      [names objectAtIndex:i], [values objectAtIndex:i]);
+            
+            success = NO;
+            
+            break;
+        }
+        
+        appliedNum++;
+        
+        if (![updateComponents containsObject:[components objectAtIndex:i]])
+            [updateComponents addObject:[components objectAtIndex:i]];
+    }
+    
+    if (success)
+    {
+        for (NSValue *theComponent in updateComponents)
+        {
+            if (!((OEComponent *)[theComponent pointerValue])->update())
+            {
+                if (isDebug)
+                    NSLog(@"Settings transaction: component update failed");
+                
+                success = NO;
+            }
+        }
+    }
+    
+    if (!success)
+    {
+        for (NSInteger i = appliedNum - 1; i >= 0; i--)
+        {
+            OEComponent *component = (OEComponent *)[[components objectAtIndex:i]
+                                                     pointerValue];
+            component->setValue([[names objectAtIndex:i] cppString],
+                                [[oldValues objectAtIndex:i] cppString]);
+        }
+        
+        // Components whose values were only set, not updated, are
+        // restored by setValue alone; updated ones need another pass
+        if (appliedNum == count)
+        {
+            for (NSValue *theComponent in updateComponents)
+                ((OEComponent *)[theComponent pointerValue])->update();
+        }
+    }
+    
+    [document unlockEmulation];
+    
+    if (isDebug)
+        NSLog(@"Settings transaction: %lu settings, %lu components, %s in %.3f ms",
+              (unsigned long) count,
+              (unsigned long) [updateComponents count],
+              success ? "applied" : "rolled back",
+              (CFAbsoluteTimeGetCurrent() - startTime) * 1000);
+    
+    [components removeAllObjects];
+    [names removeAllObjects];
+    [values removeAllObjects];
+    
+    return success;
+}
+
+@end
@@ -12,9 +12,8 @@
 
 #import "TemplateChooserItem.h"
 
-#import "NSStringAdditions.h"
-
-#import "OEDocument.h"
+#import "DocumentInfoCache.h"
+#import "ImageCache.h"
 
 @implementation TemplateChooserItem
 
@@ -44,19 +43,17 @@
     if (loaded)
         return;
     
-    OEDocument oeDocument;
-    oeDocument.open([path cppString]);
-    if (oeDocument.isOpen())
+    NSDictionary *info = [[DocumentInfoCache sharedCache] infoForPath:path];
+    if (info)
     {
-        OEHeaderInfo headerInfo = oeDocument.getHeaderInfo();
         NSString *resourcePath = [[NSUserDefaults standardUserDefaults] URLForKey:@"OEDefaultResourcesPath"].path;
         
         label = [[[path lastPathComponent] stringByDeletingPathExtension]
                  retain];
         NSString *imagePath = [resourcePath stringByAppendingPathComponent:
-                               [NSString stringWithCPPString:headerInfo.image]];
-        image = [[NSImage alloc] initWithContentsOfFile:imagePath];
-        description = [[NSString stringWithCPPString:headerInfo.description] retain];
+                               [info objectForKey:@"image"]];
+        image = [[[ImageCache sharedCache] imageForPath:imagePath] retain];
+        description = [[info objectForKey:@"description"] retain];
     }
     
     loaded = YES;
@@ -0,0 +1,262 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Text Screen
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Extracts the text screen of a canvas for automation
+ */
+
+#include <sys/time.h>
+
+#include "TextScreen.h"
+
+#include "OpenGLCanvas.h"
+
+#include "AudioInterface.h"
+
+TextScreen::TextScreen()
+{
+    audio = NULL;
+    canvas = NULL;
+    
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    
+    sequence = 0;
+    frameCount = 0;
+    isClosed = false;
+}
+
+TextScreen::~TextScreen()
+{
+    setAudio(NULL);
+    
+    close();
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+void TextScreen::setAudio(OEComponent *audio)
+{
+    if (this->audio)
+        this->audio->removeObserver(this, AUDIO_FRAME_DID_RENDER);
+    
+    this->audio = audio;
+    
+    if (audio)
+        audio->addObserver(this, AUDIO_FRAME_DID_RENDER);
+}
+
+// Must be called with the emulation locked
+void TextScreen::setCanvas(OEComponent *canvas)
+{
+    this->canvas = canvas;
+    
+    pthread_mutex_lock(&mutex);
+    
+    rows.clear();
+    sequence++;
+    
+    pthread_mutex_unlock(&mutex);
+}
+
+OEComponent *TextScreen::getCanvas()
+{
+    return canvas;
+}
+
+// Counts the changes found by update(), which runs on request and every
+// TEXTSCREEN_REFRESH_FRAMES frames while a wait is pending; changes between
+// refreshes are not seen
+OELong TextScreen::getSequence()
+{
+    pthread_mutex_lock(&mutex);
+    
+    OELong value = sequence;
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return value;
+}
+
+TextScreenRows TextScreen::getRows()
+{
+    pthread_mutex_lock(&mutex);
+    
+    TextScreenRows value = rows;
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return value;
+}
+
+// Must be called with the emulation locked
+bool TextScreen::update()
+{
+    if (!canvas)
+        return false;
+    
+    wstring text;
+    ((OpenGLCanvas *)canvas)->doCopy(text);
+    
+    TextScreenRows newRows;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find(L'\n', start);
+        if (end == wstring::npos)
+            end = text.size();
+        
+        newRows.push_back(text.substr(start, end - start));
+        
+        start = end + 1;
+    }
+    
+    pthread_mutex_lock(&mutex);
+    
+    bool isChanged = (newRows != rows);
+    if (isChanged)
+    {
+        rows.swap(newRows);
+        sequence++;
+        
+        for (TextScreenWaits::iterator i = waits.begin();
+             i != waits.end();
+             i++)
+        {
+            if (isMatch(*i))
+                (*i)->isMatched = true;
+        }
+        
+        pthread_cond_broadcast(&cond);
+    }
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return isChanged;
+}
+
+// Must be called with the emulation locked, so the screen cannot be deleted
+// before the wait is registered. The rows should be refreshed with update()
+// first, or the first match is made against stale text.
+TextScreenWait *TextScreen::addWait(wstring text, int row)
+{
+    TextScreenWait *wait = new TextScreenWait();
+    wait->text = text;
+    wait->row = row;
+    
+    pthread_mutex_lock(&mutex);
+    
+    wait->isMatched = isMatch(wait);
+    
+    waits.push_back(wait);
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return wait;
+}
+
+// Must be called without the emulation lock, so the emulation keeps running.
+// Frees the wait; fails on timeout or when the screen is closed.
+bool TextScreen::waitForText(TextScreenWait *wait, float timeout)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    
+    struct timespec deadline;
+    double deadlineTime = now.tv_sec + now.tv_usec * 1E-6 + timeout;
+    deadline.tv_sec = (time_t) deadlineTime;
+    deadline.tv_nsec = (long) ((deadlineTime - deadline.tv_sec) * 1E9);
+    
+    pthread_mutex_lock(&mutex);
+    
+    while (!wait->isMatched && !isClosed)
+    {
+        if (pthread_cond_timedwait(&cond, &mutex, &deadline))
+            break;
+    }
+    
+    for (TextScreenWaits::iterator i = waits.begin();
+         i != waits.end();
+         i++)
+    {
+        if (*i == wait)
+        {
+            waits.erase(i);
+            
+            break;
+        }
+    }
+    
+    bool value = wait->isMatched && !isClosed;
+    
+    delete wait;
+    
+    // Let close() know the last waiter has left
+    if (isClosed && waits.empty())
+        pthread_cond_broadcast(&cond);
+    
+    pthread_mutex_unlock(&mutex);
+    
+    return value;
+}
+
+// Fails every pending wait and returns once all waiters have left, so the
+// screen can then be deleted
+void TextScreen::close()
+{
+    pthread_mutex_lock(&mutex);
+    
+    isClosed = true;
+    
+    pthread_cond_broadcast(&cond);
+    
+    while (!waits.empty())
+        pthread_cond_wait(&cond, &mutex);
+    
+    pthread_mutex_unlock(&mutex);
+}
+
+void TextScreen::notify(OEComponent *sender, int notification, void *data)
+{
+    // Called with the emulation locked, after a frame was rendered
+    pthread_mutex_lock(&mutex);
+    
+    bool isWaiting = !waits.empty();
+    
+    pthread_mutex_unlock(&mutex);
+    
+    if (!isWaiting)
+        return;
+    
+    if (++frameCount < TEXTSCREEN_REFRESH_FRAMES)
+        return;
+    
+    frameCount = 0;
+    
+    update();
+}
+
+bool TextScreen::isMatch(TextScreenWait *wait)
+{
+    if (wait->row != TEXTSCREEN_ANYROW)
+    {
+        if ((wait->row < 0) || (wait->row >= (int) rows.size()))
+            return false;
+        
+        return (rows[wait->row].find(wait->text) != wstring::npos);
+    }
+    
+    for (TextScreenRows::iterator i = rows.begin();
+         i != rows.end();
+         i++)
+    {
+        if (i->find(wait->text) != wstring::npos)
+            return true;
+    }
+    
+    return false;
+}
@@ -0,0 +1,72 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Text Screen
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Extracts the text screen of a canvas for automation
+ */
+
+#ifndef _TEXTSCREEN_H
+#define _TEXTSCREEN_H
+
+#include <pthread.h>
+#include <vector>
+
+#include "OEComponent.h"
+
+// Frames between screen refreshes while a wait is pending
+#define TEXTSCREEN_REFRESH_FRAMES   4
+
+// Matches text on any row of the screen
+#define TEXTSCREEN_ANYROW           -1
+
+typedef vector<wstring> TextScreenRows;
+
+typedef struct
+{
+    wstring text;
+    int row;
+    bool isMatched;
+} TextScreenWait;
+
+typedef vector<TextScreenWait *> TextScreenWaits;
+
+class TextScreen : public OEComponent
+{
+public:
+    TextScreen();
+    ~TextScreen();
+    
+    void setAudio(OEComponent *audio);
+    void setCanvas(OEComponent *canvas);
+    OEComponent *getCanvas();
+    
+    OELong getSequence();
+    TextScreenRows getRows();
+    bool update();
+    
+    TextScreenWait *addWait(wstring text, int row);
+    bool waitForText(TextScreenWait *wait, float timeout);
+    void close();
+    
+    void notify(OEComponent *sender, int notification, void *data);
+
+private:
+    OEComponent *audio;
+    OEComponent *canvas;
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    
+    OELong sequence;
+    TextScreenRows rows;
+    TextScreenWaits waits;
+    OEInt frameCount;
+    bool isClosed;
+    
+    bool isMatch(TextScreenWait *wait);
+};
+
+#endif
@@ -0,0 +1,37 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Text Screen Script
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Waits for and prints the text screen of a document from the command line
+ */
+
+#import <Cocoa/Cocoa.h>
+
+#define TEXTSCREENSCRIPT_ARGUMENT   @"--text-screen"
+#define TEXTSCREENSCRIPT_TIMEOUT    60.0
+
+@class Document;
+
+@interface TextScreenScript : NSObject
+{
+    NSString *documentPath;
+    NSMutableArray *settings;
+    NSString *text;
+    NSInteger row;
+    double timeout;
+    
+    Document *document;
+    volatile BOOL waitFinished;
+    BOOL matched;
+}
+
++ (BOOL)isRequested;
++ (void)runWithProcessArguments;
+
+- (id)initWithArguments:(NSArray *)arguments;
+- (int)run;
+
+@end
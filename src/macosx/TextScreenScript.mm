@@ -0,0 +1,196 @@
+
+/**
+ * OpenEmulator
+ * Mac OS X Text Screen Script
+ * (C) 2026 by the OpenEmulator Project
+ * Released under the GPL
+ *
+ * Waits for and prints the text screen of a document from the command line
+ */
+
+#import "TextScreenScript.h"
+
+#import "DocumentController.h"
+#import "Document.h"
+#import "SettingsTransaction.h"
+
+@implementation TextScreenScript
+
++ (BOOL)isRequested
+{
+    return [[[NSProcessInfo processInfo] arguments] containsObject:TEXTSCREENSCRIPT_ARGUMENT];
+}
+
++ (void)runWithProcessArguments
+{
+    NSArray *arguments = [[NSProcessInfo processInfo] arguments];
+    NSUInteger index = [arguments indexOfObject:TEXTSCREENSCRIPT_ARGUMENT];
+    arguments = [arguments subarrayWithRange:NSMakeRange(index + 1,
+                                                         [arguments count] - index - 1)];
+    
+    TextScreenScript *textScreenScript = [[TextScreenScript alloc] initWithArguments:arguments];
+    
+    int result = textScreenScript ? [textScreenScript run] : 2;
+    
+    [textScreenScript release];
+    
+    exit(result);
+}
+
+- (id)initWithArguments:(NSArray *)arguments
+{
+    self = [super init];
+    
+    if (self)
+    {
+        settings = [[NSMutableArray alloc] init];
+        row = -1;
+        timeout = TEXTSCREENSCRIPT_TIMEOUT;
+        
+        for (NSUInteger i = 0; i < [arguments count]; i++)
+        {
+            NSString *argument = [arguments objectAtIndex:i];
+            BOOL hasValue = (i + 1 < [arguments count]);
+            
+            if ([argument isEqualToString:@"--set"] && hasValue)
+                [settings addObject:[arguments objectAtIndex:++i]];
+            else if ([argument isEqualToString:@"--wait"] && hasValue)
+                text = [[arguments objectAtIndex:++i] copy];
+            else if ([argument isEqualToString:@"--row"] && hasValue)
+                row = [[arguments objectAtIndex:++i] integerValue];
+            else if ([argument isEqualToString:@"--timeout"] && hasValue)
+                timeout = [[arguments objectAtIndex:++i] doubleValue];
+            else if (!documentPath)
+                documentPath = [[argument stringByExpandingTildeInPath] copy];
+        }
+        
+        if (!documentPath)
+        {
+            fprintf(stderr, "usage: OpenEmulator --text-screen <document> "
+                    "[--set component.setting=value ...] "
+                    "[--wait text] [--row n] [--timeout seconds]\n");
+            
+            [self release];
+            
+            return nil;
+        }
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    [documentPath release];
+    [settings release];
+    [text release];
+    
+    [super dealloc];
+}
+
+// All settings are applied in one transaction, so the machine is only
+// reconfigured once, and not at all if any of them is rejected
+- (BOOL)applySettings
+{
+    SettingsTransaction *transaction = [[[SettingsTransaction alloc] initWithDocument:document]
+                                        autorelease];
+    
+    for (NSString *setting in settings)
+    {
+        NSRange valueRange = [setting rangeOfString:@"="];
+        NSRange nameRange = valueRange;
+        if (valueRange.length)
+            nameRange = [setting rangeOfString:@"."
+                                       options:NSBackwardsSearch
+                                         range:NSMakeRange(0, valueRange.location)];
+        
+        if (!nameRange.length ||
+            ![transaction setValue:[setting substringFromIndex:NSMaxRange(valueRange)]
+                        forSetting:[setting substringWithRange:
+                                    NSMakeRange(NSMaxRange(nameRange),
+                                                valueRange.location - NSMaxRange(nameRange))]
+                 ofComponentWithId:[setting substringToIndex:nameRange.location]])
+        {
+            fprintf(stderr, "%s: invalid setting\n", [setting UTF8String]);
+            
+            return NO;
+        }
+    }
+    
+    if (![transaction commit])
+    {
+        fprintf(stderr, "%s: settings were rejected\n", [documentPath UTF8String]);
+        
+        return NO;
+    }
+    
+    return YES;
+}
+
+- (void)waitForText:(id)object
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    matched = [document waitForTextScreen:text
+                                      row:row
+                                  timeout:timeout];
+    
+    waitFinished = YES;
+    
+    [pool drain];
+}
+
+// Applies the settings, then prints the rows once the text is found, or at
+// once without --wait. The wait runs on its own thread, so canvases can
+// still be set up meanwhile.
+- (int)run
+{
+    DocumentController *documentController = [NSDocumentController sharedDocumentController];
+    
+    NSError *error = nil;
+    document = [documentController openUntitledDocumentWithTemplateURL:
+                [NSURL fileURLWithPath:documentPath]
+                                                               display:NO
+                                                                 error:&error];
+    if (!document || ![document emulation])
+    {
+        fprintf(stderr, "%s: cannot open document\n", [documentPath UTF8String]);
+        
+        return 2;
+    }
+    
+    if ([settings count] && ![self applySettings])
+    {
+        [document close];
+        
+        return 2;
+    }
+    
+    matched = YES;
+    
+    if (text)
+    {
+        [NSThread detachNewThreadSelector:@selector(waitForText:)
+                                 toTarget:self
+                               withObject:nil];
+        
+        while (!waitFinished)
+            [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode
+                                     beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    }
+    
+    printf("sequence %lld\n", [document textScreenSequence]);
+    
+    for (NSString *rowText in [document textScreenRows])
+        printf("%s\n", [rowText UTF8String]);
+    
+    if (!matched)
+        fprintf(stderr, "%s: \"%s\" not found\n",
+                [documentPath UTF8String], [text UTF8String]);
+    
+    [document close];
+    
+    return matched ? 0 : 1;
+}
+
+@end
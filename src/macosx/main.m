@@ -10,7 +10,35 @@
 
 #import <Cocoa/Cocoa.h>
 
+#import "DiskImageConverter.h"
+#import "DocumentInfoCache.h"
+#import "LibrarySearchIndex.h"
+
 int main(int argc, char *argv[])
 {
+    // Headless tools
+    if ((argc > 1) && (!strcmp(argv[1], "--convert-disk-images") ||
+                       !strcmp(argv[1], "--benchmark-library-search") ||
+                       !strcmp(argv[1], "--benchmark-document-info")))
+    {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        
+        NSMutableArray *arguments = [NSMutableArray array];
+        for (int i = 2; i < argc; i++)
+            [arguments addObject:[NSString stringWithUTF8String:argv[i]]];
+        
+        int result;
+        if (!strcmp(argv[1], "--convert-disk-images"))
+            result = [DiskImageConverter runWithArguments:arguments];
+        else if (!strcmp(argv[1], "--benchmark-library-search"))
+            result = [LibrarySearchIndex runBenchmarkWithArguments:arguments];
+        else
+            result = [DocumentInfoCache runBenchmarkWithArguments:arguments];
+        
+        [pool drain];
+        
+        return result;
+    }
+    
     return NSApplicationMain(argc, (const char **) argv);
 }